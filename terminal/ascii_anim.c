@@ -0,0 +1,347 @@
+#include "ascii_anim.h"
+#include "ascii_engine.h"
+#include "global.h"
+#include "glyph_cache.h"
+#include "pipeline_mem.h"
+#include "workers.h"
+#include "stb_image.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    uint8_t *grid;          /* rows * cols ramp glyph indices */
+    SDL_Texture *texture;   /* NULL until shown, or once the budget is spent */
+    int delay_ms;
+} AnimFrame;
+
+static struct {
+    BOOL active;
+    unsigned char *rgba;    /* decoded frames, released once every grid exists */
+    int *delays;
+    int width;
+    int height;
+    int frame_count;
+    int converted;
+    AnimFrame *frames;
+
+    int cols;
+    int rows;
+    AsciiRamp ramp;
+    int mode;
+
+    GlyphTiles glyphs;      /* one RGBA tile per ramp glyph */
+    int tex_w;
+    int tex_h;
+    uint8_t *compose;       /* tex_w * tex_h RGBA */
+    SDL_Texture *scratch;   /* streaming texture for frames past the budget */
+
+    size_t cache_bytes;
+    int current;
+    Uint32 next_at;
+    Uint32 started;
+} anim;
+
+int ascii_anim_is_gif(const unsigned char *data, int size) {
+    return data && size >= 6 && memcmp(data, "GIF8", 4) == 0;
+}
+
+/* Skip data sub-blocks starting at p; returns the offset after the terminator, or -1 */
+static long skip_sub_blocks(const unsigned char *data, long size, long p) {
+    while (p < size) {
+        int len = data[p++];
+        if (len == 0) return p;
+        p += len;
+    }
+    return -1;
+}
+
+/*
+ Frames counted by walking the GIF blocks without decoding anything; the
+ logical screen size goes to w and h. Returns 0 when data is not a GIF.
+*/
+static int gif_frames(const unsigned char *data, int size, int *w, int *h) {
+    if (!ascii_anim_is_gif(data, size) || size < 13) return 0;
+    *w = data[6] | data[7] << 8;
+    *h = data[8] | data[9] << 8;
+
+    long p = 13;
+    if (data[10] & 0x80) p += 3L << ((data[10] & 7) + 1);    // global color table
+
+    int frames = 0;
+    while (p >= 0 && p < size) {
+        int block = data[p++];
+        if (block == 0x3B) break;                   // trailer
+        if (block == 0x21) {                        // extension: label, then sub-blocks
+            p = skip_sub_blocks(data, size, p + 1);
+        } else if (block == 0x2C) {                 // image: descriptor, color table, LZW size, data
+            frames++;                               // stb still returns a frame cut short
+            if (p + 9 > size) break;
+            int packed = data[p + 8];
+            p += 9;
+            if (packed & 0x80) p += 3L << ((packed & 7) + 1);
+            p = skip_sub_blocks(data, size, p + 1);
+        } else {
+            break;
+        }
+    }
+    return frames;
+}
+
+int ascii_anim_active(void) {
+    return anim.active;
+}
+
+static TerminalLine *find_anim_line(void) {
+    for (int i = 0; i < _terminal.line_count; i++) {
+        if (_terminal.lines[i].flags & LINE_FLAG_ANIMATED) return &_terminal.lines[i];
+    }
+    return NULL;
+}
+
+/* Glyphs in the terminal color over a transparent background, like a text line */
+static int build_anim_tiles(int font_size) {
+    if (TTF_WasInit() == 0) TTF_Init();
+    TTF_Font *font = TTF_OpenFont(FONT_PATH, font_size);
+    if (!font) return 0;
+    TTF_SetFontStyle(font, TTF_STYLE_BOLD);
+
+    const char *strs[ASCII_RAMP_MAX];
+    for (int i = 0; i < anim.ramp.count; i++) strs[i] = anim.ramp.glyph[i];
+
+    int ok = glyph_tiles_build(&anim.glyphs, font, strs, anim.ramp.count, _terminal.settings.font_color);
+    TTF_CloseFont(font);
+    return ok;
+}
+
+static int convert_frame(int i) {
+    AnimFrame *f = &anim.frames[i];
+    size_t grid_bytes = (size_t)anim.cols * anim.rows;
+
+    f->grid = (uint8_t *)malloc(grid_bytes);
+    if (!f->grid) return 0;
+
+    const unsigned char *px = anim.rgba + (size_t)i * anim.width * anim.height * 4;
+    if (!ascii_grid_fill(px, anim.width, anim.height, anim.cols, anim.rows, &anim.ramp, anim.mode, f->grid)) {
+        free(f->grid);
+        f->grid = NULL;
+        return 0;
+    }
+
+    int delay = anim.delays ? anim.delays[i] : 0;
+    f->delay_ms = delay > 10 ? delay : ANIM_DEFAULT_DELAY;
+    anim.cache_bytes += grid_bytes;
+    anim.converted++;
+    return 1;
+}
+
+/* Cached texture of frame i, composing it on first use */
+static SDL_Texture *frame_texture(int i) {
+    AnimFrame *f = &anim.frames[i];
+    if (f->texture) return f->texture;
+
+    GlyphStamp job = {
+        .cells = f->grid,
+        .cols = anim.cols,
+        .cell_w = anim.glyphs.cell_w,
+        .cell_h = anim.glyphs.cell_h,
+        .bpp = 4,
+        .tiles = anim.glyphs.rgba,
+        .pixels = anim.compose,
+        .pitch = anim.tex_w * 4,
+    };
+    run_bands(glyph_stamp_rows, &job, anim.rows);
+
+    size_t tex_bytes = (size_t)anim.tex_w * anim.tex_h * 4;
+    SDL_Texture *tex = NULL;
+
+    if (anim.cache_bytes + tex_bytes <= ANIM_CACHE_BUDGET) {
+        tex = SDL_CreateTexture(_sdl.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                anim.tex_w, anim.tex_h);
+        if (tex) {
+            f->texture = tex;
+            anim.cache_bytes += tex_bytes;
+        }
+    }
+    if (!tex) {
+        if (!anim.scratch) {
+            anim.scratch = SDL_CreateTexture(_sdl.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING,
+                                             anim.tex_w, anim.tex_h);
+            if (!anim.scratch) return NULL;
+        }
+        tex = anim.scratch;
+    }
+
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    SDL_UpdateTexture(tex, NULL, anim.compose, anim.tex_w * 4);
+    return tex;
+}
+
+static void release_decoded(void) {
+    if (anim.rgba) stbi_image_free(anim.rgba);
+    if (anim.delays) stbi_image_free(anim.delays);
+    anim.rgba = NULL;
+    anim.delays = NULL;
+}
+
+void ascii_anim_stop(void) {
+    if (!anim.active) return;
+
+    // The line keeps whatever frame it is showing and owns it from now on
+    TerminalLine *line = find_anim_line();
+    SDL_Texture *keep = line ? line->texture : NULL;
+    if (line) line->flags = (TerminalLineFlags)(line->flags & ~LINE_FLAG_ANIMATED);
+
+    for (int i = 0; i < anim.frame_count; i++) {
+        if (anim.frames[i].texture && anim.frames[i].texture != keep) {
+            SDL_DestroyTexture(anim.frames[i].texture);
+        }
+        free(anim.frames[i].grid);
+    }
+    if (anim.scratch && anim.scratch != keep) SDL_DestroyTexture(anim.scratch);
+
+    free(anim.frames);
+    glyph_tiles_free(&anim.glyphs);
+    free(anim.compose);
+    release_decoded();
+    memset(&anim, 0, sizeof(anim));
+}
+
+int ascii_anim_start(const unsigned char *data, int size, int cols, float char_aspect,
+                     int font_size, const AsciiRamp *ramp, int mode, int tone) {
+    ascii_anim_stop();
+    if (!ramp || ramp->count == 0 || cols <= 0) return 0;
+
+    // Still GIFs go to the still preview without being decoded here
+    int width, height;
+    int frames = gif_frames(data, size, &width, &height);
+    if (frames < 2 || width <= 0 || height <= 0) return 0;
+
+    // Grids may use at most half the budget; frames past that are dropped
+    int rows = ascii_grid_rows(width, height, cols, char_aspect);
+    size_t grid_bytes = (size_t)cols * rows;
+    int max_frames = (int)(ANIM_CACHE_BUDGET / 2 / grid_bytes);
+    if (max_frames < 1) {
+        add_terminal_line("Warning: grid too large to animate (try a smaller wide=), showing the first frame",
+                          LINE_FLAG_WARNING);
+        return 0;
+    }
+
+    /*
+     stb decodes every frame at full size before returning any of them. It
+     grows the output with a realloc per frame, which may copy it (two outputs
+     at the peak), and keeps a frame, a background and a history plane aside.
+    */
+    size_t frame_bytes = (size_t)width * height * 4;
+    size_t decoded_bytes = 2 * frame_bytes * frames + (size_t)width * height * 9;
+    if (!pipeline_admit(decoded_bytes)) {
+        char msg[160];
+        snprintf(msg, sizeof(msg), "Error: %d-frame %d × %d GIF needs %zu MB, over the %zu MB budget (to_ascii mem=<MB>)",
+                 frames, width, height, (decoded_bytes + 0xFFFFF) >> 20, pipeline_budget() >> 20);
+        add_terminal_line(msg, LINE_FLAG_ERROR);
+        return 0;
+    }
+
+    int *delays = NULL;
+    int comp;
+    unsigned char *rgba = stbi_load_gif_from_memory(data, size, &delays, &width, &height, &frames, &comp, 4);
+    if (!rgba) return 0;
+    if (frames < 2) {
+        stbi_image_free(rgba);
+        if (delays) stbi_image_free(delays);
+        return 0;
+    }
+
+    anim.active = TRUE;
+    anim.rgba = rgba;
+    anim.delays = delays;
+    anim.width = width;
+    anim.height = height;
+    anim.cols = cols;
+    anim.rows = ascii_grid_rows(width, height, cols, char_aspect);
+    anim.ramp = *ramp;
+    anim.mode = mode;
+    ascii_ramp_tone(&anim.ramp, rgba, width, height, anim.rows, tone);
+    anim.started = SDL_GetTicks();
+
+    anim.frame_count = frames < max_frames ? frames : max_frames;
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Animated GIF: %d frames, %d × %d → %d × %d chars",
+             frames, width, height, cols, anim.rows);
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
+    if (anim.frame_count < frames) {
+        snprintf(buf, sizeof(buf), "Warning: frame cache budget reached, playing first %d frames", anim.frame_count);
+        add_terminal_line(buf, LINE_FLAG_WARNING);
+    }
+
+    anim.frames = (AnimFrame *)calloc(anim.frame_count, sizeof(AnimFrame));
+    if (!anim.frames || !build_anim_tiles(font_size)) {
+        add_terminal_line("Error: Cannot set up GIF playback", LINE_FLAG_ERROR);
+        ascii_anim_stop();
+        return 0;
+    }
+
+    anim.tex_w = cols * anim.glyphs.cell_w;
+    anim.tex_h = anim.rows * anim.glyphs.cell_h;
+    anim.compose = (uint8_t *)malloc((size_t)anim.tex_w * anim.tex_h * 4);
+
+    // First frame right away so the animation sits under its header
+    SDL_Texture *first = NULL;
+    if (anim.compose && convert_frame(0)) first = frame_texture(0);
+    if (!first) {
+        add_terminal_line("Error: Cannot convert first GIF frame", LINE_FLAG_ERROR);
+        ascii_anim_stop();
+        return 0;
+    }
+
+    add_terminal_texture_line(first, anim.tex_w, anim.tex_h, LINE_FLAG_ANIMATED);
+    anim.current = 0;
+    anim.next_at = SDL_GetTicks() + anim.frames[0].delay_ms;
+    return 1;
+}
+
+void ascii_anim_tick(void) {
+    if (!anim.active) return;
+
+    // Scrolled out of the FIFO or cleared: nothing left to play into
+    if (!find_anim_line()) {
+        ascii_anim_stop();
+        return;
+    }
+
+    Uint32 start = SDL_GetTicks();
+    while (anim.converted < anim.frame_count && SDL_GetTicks() - start < ANIM_SLICE_MS) {
+        if (!convert_frame(anim.converted)) {
+            anim.frame_count = anim.converted;
+            add_terminal_line("Warning: out of memory, GIF truncated", LINE_FLAG_WARNING);
+        }
+    }
+
+    if (anim.rgba && anim.converted == anim.frame_count) {
+        release_decoded();
+        char buf[128];
+        snprintf(buf, sizeof(buf), "GIF converted: %d frames in %u ms", anim.frame_count, SDL_GetTicks() - anim.started);
+        add_terminal_line(buf, LINE_FLAG_SYSTEM);
+    }
+
+    Uint32 now = SDL_GetTicks();
+    if ((Sint32)(now - anim.next_at) < 0) return;
+
+    // Loop only once every frame exists; otherwise wait for the converter
+    int next = anim.current + 1;
+    if (next >= anim.converted) {
+        if (anim.converted < anim.frame_count) return;
+        next = 0;
+    }
+    if (next == anim.current) return;
+
+    SDL_Texture *tex = frame_texture(next);
+    TerminalLine *line = find_anim_line();
+    if (!tex || !line) return;
+
+    line->texture = tex;
+    anim.current = next;
+    anim.next_at = now + anim.frames[next].delay_ms;
+    _terminal.dirty = TRUE;
+}
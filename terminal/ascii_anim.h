@@ -0,0 +1,42 @@
+#ifndef ASCII_ANIM_H
+#define ASCII_ANIM_H
+
+#include "ascii_engine.h"
+
+/*
+Animated GIF playback in the scrollback
+
+All frames are decoded up front, then converted to character grids a few
+per tick so the terminal stays responsive. Grids are composed into textures
+from pre-rasterized glyph tiles; playback only swaps the texture of one
+scrollback line at each frame's delay. Textures are cached until
+ANIM_CACHE_BUDGET is reached; later frames are re-stamped from their cached
+grid into one streaming texture.
+*/
+
+#define ANIM_CACHE_BUDGET   (32 * 1024 * 1024)
+#define ANIM_SLICE_MS       12      /* conversion time per tick */
+#define ANIM_DEFAULT_DELAY  100     /* ms, for frames that specify <= 10 ms */
+
+/* 1 if data starts with a GIF signature */
+int ascii_anim_is_gif(const unsigned char *data, int size);
+
+/*
+ Decode every frame and start playback; the previous animation is frozen on
+ its current frame. The tone curve is fitted to the first frame and kept for
+ all of them, so levels don't flicker. Returns 0 (nothing started) for
+ single-frame or undecodable GIFs, and for GIFs whose decoded frames do not
+ fit the pipeline memory budget.
+*/
+int ascii_anim_start(const unsigned char *data, int size, int cols, float char_aspect,
+                     int font_size, const AsciiRamp *ramp, int mode, int tone);
+
+/* Convert pending frames and advance playback; call once per main loop tick */
+void ascii_anim_tick(void);
+
+/* Stop playback, leaving the current frame in the scrollback */
+void ascii_anim_stop(void);
+
+int ascii_anim_active(void);
+
+#endif /* ASCII_ANIM_H */
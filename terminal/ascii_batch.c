@@ -0,0 +1,376 @@
+/*
+Native batch ASCII converter
+
+Converts every image of a directory to ASCII art (PNG and/or TXT) with the
+same engine as the terminal, one image per worker thread, and reports
+throughput and per-stage timings.
+
+Usage: ascii_batch <in_dir> <out_dir> [wide=130 font_size=7 ramp=1 mode=ramp|shape|braille|halfblock|edges|pixel
+                   tone=off format=png level=5 bits=0 palette=0 bg=black color=white font=font.ttf]
+*/
+
+#include "ascii_engine.h"
+#include "jpeg_decode.h"
+#include "stb_image.h"
+#include "workers.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#define BATCH_FORMAT_PNG  1
+#define BATCH_FORMAT_TXT  2
+
+enum { STAGE_DECODE, STAGE_GRID, STAGE_TXT, STAGE_PNG, STAGE_COUNT };
+static const char *stage_names[STAGE_COUNT] = { "decode", "grid", "txt", "png" };
+
+typedef struct {
+    int chars_wide;
+    int font_size;
+    const char *ramp_text;  /* preset picked by ramp= */
+    AsciiRamp ramp;         /* parsed once, shared read-only by the workers */
+    int mode;
+    int tone;
+    int formats;            /* BATCH_FORMAT_* bits */
+    int png_level;
+    int png_bits;
+    int palette;            /* mode=halfblock: k-means colors, 0 = true color */
+    uint8_t fg[3];
+    uint8_t bg[3];
+    const char *font;
+} BatchOptions;
+
+typedef struct {
+    const BatchOptions *opts;
+    const AsciiTileset *tileset;
+    const char *in_dir;
+    const char *out_dir;
+    char **names;
+    int count;
+    SDL_atomic_t next;
+    SDL_atomic_t failed;
+    Uint64 stage_ticks[WORKERS_MAX][STAGE_COUNT];   /* per worker, no sharing */
+} Batch;
+
+static int has_image_ext(const char *name) {
+    static const char *exts[] = { ".png", ".jpg", ".jpeg", ".gif", ".bmp", ".tga", ".psd", ".pnm", ".ppm", ".pgm" };
+    const char *dot = strrchr(name, '.');
+    if (!dot) return 0;
+    for (size_t i = 0; i < sizeof(exts) / sizeof(exts[0]); i++) {
+        if (strcasecmp(dot, exts[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int cmp_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* out_dir/<name without extension><ext> */
+static void output_path(char *dst, size_t size, const char *out_dir, const char *name, const char *ext) {
+    const char *dot = strrchr(name, '.');
+    int stem = dot ? (int)(dot - name) : (int)strlen(name);
+    snprintf(dst, size, "%s/%.*s%s", out_dir, stem, name, ext);
+}
+
+/* Whole file in memory; NULL on failure */
+static unsigned char *read_file(const char *path, int *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    unsigned char *data = NULL;
+    long n = (fseek(f, 0, SEEK_END) == 0) ? ftell(f) : -1;
+    if (n > 0 && n < (1L << 30) && fseek(f, 0, SEEK_SET) == 0 && (data = (unsigned char *)malloc(n)) != NULL) {
+        if (fread(data, 1, n, f) != (size_t)n) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(f);
+    *size = (int)n;
+    return data;
+}
+
+/* RGBA pixels; large JPEGs come out of the scaled decoder at the size the grid can use (luma only but for halfblock) */
+static unsigned char *load_image(const char *path, const BatchOptions *o, int *width, int *height) {
+    int size, full_w, full_h, channels;
+    unsigned char *data = read_file(path, &size);
+    if (!data) return NULL;
+
+    unsigned char *pixels = NULL;
+    if (jpeg_info(data, size, &full_w, &full_h)) {
+        int scale = jpeg_pick_scale(full_w, ascii_source_width(o->chars_wide, o->mode));
+        int flags = o->mode == ASCII_MODE_HALFBLOCK ? 0 : JPEG_GRAY;
+        if (scale > 1) pixels = jpeg_decode(data, size, scale, flags, width, height);
+    }
+    if (!pixels) pixels = stbi_load_from_memory(data, size, width, height, &channels, 4);
+    free(data);
+    return pixels;
+}
+
+static int convert_one(Batch *b, int i, Uint64 *ticks) {
+    const BatchOptions *o = b->opts;
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", b->in_dir, b->names[i]);
+
+    Uint64 t0 = SDL_GetPerformanceCounter();
+    int width, height;
+    unsigned char *pixels = load_image(path, o, &width, &height);
+    Uint64 t1 = SDL_GetPerformanceCounter();
+    ticks[STAGE_DECODE] += t1 - t0;
+    if (!pixels) {
+        fprintf(stderr, "skip %s: cannot decode\n", b->names[i]);
+        return 0;
+    }
+
+    int cols = o->chars_wide;
+    int rows = ascii_grid_rows(width, height, cols, ASCII_EXPORT_ASPECT);
+    AsciiRamp ramp = o->ramp;
+    ascii_ramp_tone(&ramp, pixels, width, height, rows, o->tone);
+    uint8_t *ascii = (uint8_t *)malloc((size_t)cols * rows * ascii_cell_bytes(o->mode));
+    int ok = ascii && ascii_grid_fill(pixels, width, height, cols, rows, &ramp, o->mode, ascii);
+    free(pixels);
+    Uint64 t2 = SDL_GetPerformanceCounter();
+    ticks[STAGE_GRID] += t2 - t1;
+    if (!ok) {
+        fprintf(stderr, "skip %s: out of memory\n", b->names[i]);
+        free(ascii);
+        return 0;
+    }
+
+    // palette=N: one index per half-block texel; text gets the palette colors back
+    Palette pal;
+    uint8_t *index = NULL;
+    if (o->mode == ASCII_MODE_HALFBLOCK && o->palette > 0) {
+        size_t n = (size_t)cols * rows * 2;
+        index = (uint8_t *)malloc(n);
+        if (index && palette_build(&pal, ascii, n, o->palette)) {
+            palette_map(&pal, ascii, n, index);
+            palette_expand(&pal, index, n, ascii);
+        } else {
+            free(index);
+            index = NULL;
+        }
+    }
+
+    char out[4096];
+    if (o->formats & BATCH_FORMAT_TXT) {
+        output_path(out, sizeof(out), b->out_dir, b->names[i], ".txt");
+        FILE *f = fopen(out, "wb");
+        ok = f && ascii_write_text(&ramp, o->mode, ascii, cols, rows, ASCII_FORMAT_TXT, o->fg, o->bg,
+                                   png_file_sink, f) > 0;
+        if (f) fclose(f);
+        if (!ok) fprintf(stderr, "failed %s: cannot write %s\n", b->names[i], out);
+    }
+    Uint64 t3 = SDL_GetPerformanceCounter();
+    ticks[STAGE_TXT] += t3 - t2;
+
+    if (ok && (o->formats & BATCH_FORMAT_PNG)) {
+        output_path(out, sizeof(out), b->out_dir, b->names[i], ".png");
+        FILE *f = fopen(out, "wb");
+        const AsciiTileset *ts = b->tileset;
+        ok = f && (index ? ascii_write_halfblock_indexed_png(index, cols, rows, ts->cell_w, ts->cell_h, &pal,
+                                                             o->png_level, png_file_sink, f)
+                   : o->mode == ASCII_MODE_HALFBLOCK
+                   ? ascii_write_halfblock_png(ascii, cols, rows, ts->cell_w, ts->cell_h, o->png_level, png_file_sink, f)
+                   : ascii_write_png(ts, ascii, cols, rows, o->png_level, png_file_sink, f)) > 0;
+        if (f) fclose(f);
+        if (!ok) fprintf(stderr, "failed %s: cannot write %s\n", b->names[i], out);
+    }
+    ticks[STAGE_PNG] += SDL_GetPerformanceCounter() - t3;
+
+    free(index);
+    free(ascii);
+    return ok;
+}
+
+/* One band per worker; images are pulled one at a time so slow ones don't stall a band */
+static void batch_worker(void *ctx, int begin, int end) {
+    Batch *b = (Batch *)ctx;
+    (void)end;
+    for (;;) {
+        int i = SDL_AtomicAdd(&b->next, 1);
+        if (i >= b->count) break;
+        if (!convert_one(b, i, b->stage_ticks[begin])) SDL_AtomicAdd(&b->failed, 1);
+    }
+}
+
+static char **list_images(const char *dir, int *count) {
+    DIR *d = opendir(dir);
+    if (!d) return NULL;
+
+    int cap = 64, n = 0;
+    char **names = (char **)malloc(cap * sizeof(char *));
+    struct dirent *e;
+    while (names && (e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.' || !has_image_ext(e->d_name)) continue;
+        if (n == cap) {
+            char **grown = (char **)realloc(names, (cap *= 2) * sizeof(char *));
+            if (!grown) break;
+            names = grown;
+        }
+        names[n++] = strdup(e->d_name);
+    }
+    closedir(d);
+
+    if (names) qsort(names, n, sizeof(char *), cmp_names);
+    *count = n;
+    return names;
+}
+
+static void parse_options(BatchOptions *o, int argc, char **argv) {
+    char key[64], val[256];
+    for (int i = 0; i < argc; i++) {
+        if (sscanf(argv[i], "%63[^=]=%255s", key, val) != 2) {
+            fprintf(stderr, "ignoring option '%s'\n", argv[i]);
+            continue;
+        }
+        if (strcmp(key, "wide") == 0) {
+            int w = atoi(val);
+            o->chars_wide = (w > 0 && w <= 500) ? w : o->chars_wide;
+        } else if (strcmp(key, "font_size") == 0) {
+            o->font_size = atoi(val);
+        } else if (strcmp(key, "ramp") == 0) {
+            o->ramp_text = ascii_ramp_preset(atoi(val));
+        } else if (strcmp(key, "mode") == 0) {
+            o->mode = ascii_mode_from_name(val);
+        } else if (strcmp(key, "tone") == 0) {
+            o->tone = tone_from_name(val);
+        } else if (strcmp(key, "format") == 0) {
+            o->formats = strcmp(val, "txt") == 0  ? BATCH_FORMAT_TXT
+                       : strcmp(val, "both") == 0 ? BATCH_FORMAT_PNG | BATCH_FORMAT_TXT
+                       : BATCH_FORMAT_PNG;
+        } else if (strcmp(key, "level") == 0) {
+            int l = atoi(val);
+            o->png_level = (l < 0) ? 0 : (l > 9) ? 9 : l;
+        } else if (strcmp(key, "bits") == 0) {
+            int b = atoi(val);
+            o->png_bits = (b == 1 || b == 2 || b == 4 || b == 8) ? b : 0;
+        } else if (strcmp(key, "palette") == 0) {
+            int n = atoi(val);
+            o->palette = (n <= 0) ? 0 : (n < 2) ? 2 : (n > PALETTE_MAX) ? PALETTE_MAX : n;
+        } else if (strcmp(key, "bg") == 0) {
+            parse_color(val, &o->bg[0], &o->bg[1], &o->bg[2]);
+        } else if (strcmp(key, "color") == 0) {
+            parse_color(val, &o->fg[0], &o->fg[1], &o->fg[2]);
+        } else if (strcmp(key, "font") == 0) {
+            o->font = strdup(val);
+        } else {
+            fprintf(stderr, "ignoring option '%s'\n", argv[i]);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <in_dir> <out_dir> [wide=130 font_size=7 ramp=1 mode=ramp|shape|braille|halfblock|edges|pixel tone=off|levels|equalize|auto "
+                        "format=png|txt|both level=5 bits=0 palette=0 bg=black color=white font=font.ttf]\n", argv[0]);
+        return 1;
+    }
+
+    BatchOptions opts = {
+        .chars_wide = 130,
+        .font_size = 7,
+        .ramp_text = RAMP_1,
+        .mode = ASCII_MODE_RAMP,
+        .tone = TONE_OFF,
+        .formats = BATCH_FORMAT_PNG,
+        .png_level = PNG_LEVEL_DEFAULT,
+        .png_bits = 0,
+        .fg = {255, 255, 255},
+        .bg = {0, 0, 0},
+        .font = "font.ttf",
+    };
+    parse_options(&opts, argc - 3, argv + 3);
+    opts.mode = ascii_export_mode(opts.mode);
+    ascii_ramp_for_mode(&opts.ramp, opts.ramp_text, opts.mode);
+
+    const char *in_dir = argv[1];
+    const char *out_dir = argv[2];
+    if (mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "cannot create %s\n", out_dir);
+        return 1;
+    }
+
+    int count = 0;
+    char **names = list_images(in_dir, &count);
+    if (!names) {
+        fprintf(stderr, "cannot read %s\n", in_dir);
+        return 1;
+    }
+    if (count == 0) {
+        printf("no images in %s\n", in_dir);
+        return 0;
+    }
+
+    if (TTF_Init() != 0) {
+        fprintf(stderr, "TTF_Init failed: %s\n", TTF_GetError());
+        return 1;
+    }
+    ascii_engine_set_font(opts.font);
+
+    // Everything touching FreeType happens here, before the workers start
+    if (opts.mode == ASCII_MODE_SHAPE && ascii_shape_glyphs(&opts.ramp) == 0) {
+        fprintf(stderr, "mode=shape: cannot build glyph templates from %s\n", opts.font);
+        return 1;
+    }
+
+    AsciiTileset tileset = {0};
+    if (opts.formats & BATCH_FORMAT_PNG) {
+        TTF_Font *font = TTF_OpenFont(opts.font, opts.font_size);
+        int ok = font && ascii_tileset_build(&tileset, font, &opts.ramp, opts.fg, opts.bg, opts.png_bits);
+        if (font) TTF_CloseFont(font);
+        if (!ok) {
+            fprintf(stderr, "cannot rasterize glyphs from %s at size %d\n", opts.font, opts.font_size);
+            return 1;
+        }
+    }
+
+    Batch *batch = (Batch *)calloc(1, sizeof(Batch));
+    if (!batch) return 1;
+    batch->opts = &opts;
+    batch->tileset = &tileset;
+    batch->in_dir = in_dir;
+    batch->out_dir = out_dir;
+    batch->names = names;
+    batch->count = count;
+
+    int threads = worker_count();
+    if (threads > count) threads = count;
+    printf("Converting %d images with %d threads...\n", count, threads);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    run_bands(batch_worker, batch, threads);
+    double freq = (double)SDL_GetPerformanceFrequency();
+    double wall = (SDL_GetPerformanceCounter() - start) / freq;
+
+    int failed = SDL_AtomicGet(&batch->failed);
+    int done = count - failed;
+    printf("%d converted, %d failed in %.2f s: %.1f images/s\n",
+           done, failed, wall, wall > 0 ? done / wall : 0.0);
+
+    // Stage times are summed over threads, so they add up to CPU time, not wall time
+    Uint64 total = 0;
+    Uint64 stage[STAGE_COUNT] = {0};
+    for (int w = 0; w < WORKERS_MAX; w++) {
+        for (int s = 0; s < STAGE_COUNT; s++) stage[s] += batch->stage_ticks[w][s];
+    }
+    for (int s = 0; s < STAGE_COUNT; s++) total += stage[s];
+
+    printf("%-8s %10s %12s %7s\n", "stage", "total ms", "ms / image", "share");
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        double ms = stage[s] * 1000.0 / freq;
+        printf("%-8s %10.1f %12.2f %6.1f%%\n", stage_names[s], ms, ms / count,
+               total ? 100.0 * stage[s] / total : 0.0);
+    }
+
+    ascii_tileset_free(&tileset);
+    for (int i = 0; i < count; i++) free(names[i]);
+    free(names);
+    free(batch);
+    TTF_Quit();
+    return failed ? 2 : 0;
+}
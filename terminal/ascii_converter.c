@@ -1,22 +1,41 @@
 #include "ascii_converter.h"
 #include "global.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image.h"
-#include "stb_image_write.h"
 
+#include "ascii_anim.h"
+#include "ascii_view.h"
 #include "base64.h"
+#include "glyph_cache.h"
+#include "jpeg_decode.h"
+#include "pipeline_mem.h"
+#include "png_writer.h"
+#include "workers.h"
+
+#include <limits.h>
+#include <sys/stat.h>
 
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #include <emscripten/emscripten.h>
 #endif
 
-static SDL_Texture *pixel_art_texture = NULL;
-static SDL_Rect pixel_art_dst = {0};  // position & size
 ExportOptions global_opts = {0};
 
+/* Preview glyph tiles, rebuilt only when the ramp glyphs, size or color change */
+static GlyphTiles preview_tiles;
+static AsciiRamp preview_tiles_ramp;
+static int preview_tiles_size;
+static SDL_Color preview_tiles_color;
+
+/* Cache key of the URL the JS bridge is fetching */
+static uint64_t pending_key = 0;
+
+/* Preview width in characters */
+static int preview_cols(void) {
+    return global_opts.chars_wide ? global_opts.chars_wide : 130;
+}
+
 void reset_export_options(ExportOptions *opts) {
     if (!opts) return;
 
@@ -33,29 +52,472 @@ void reset_export_options(ExportOptions *opts) {
 
     opts->filename = "ascii_highres.png";
     opts->ramp = RAMP_1;
+    opts->mode = ASCII_MODE_RAMP;
+    opts->tone = TONE_OFF;
+    opts->png_level = PNG_LEVEL_DEFAULT;
+    opts->png_bits = 0;
+    opts->format = ASCII_FORMAT_PNG;
+    opts->view = 0;
+    opts->palette = 0;
+}
+
+
+#ifdef __EMSCRIPTEN__
+/* Finished IDAT chunks are handed to JS as Blob parts; the PNG never sits in the WASM heap */
+static int blob_part_sink(void *ctx, const void *data, size_t len) {
+    (void)ctx;
+    EM_ASM({
+        Module.rekavBlobParts.push(Module.HEAPU8.slice($0, $0 + $1));
+    }, data, len);
+    return 1;
+}
+
+/* The collected Blob parts as a download of filename */
+static void download_blob_parts(const char *filename, const char *mime) {
+    EM_ASM_({
+        const filename = UTF8ToString($0);
+        const blob = new Blob(Module.rekavBlobParts, {type:UTF8ToString($1)});
+        Module.rekavBlobParts = null;
+        const url = URL.createObjectURL(blob);
+        const a = document.createElement("a");
+        a.href = url;
+        a.download = filename;
+        a.click();
+        URL.revokeObjectURL(url);
+    }, filename, mime);
+}
+#endif
+
+/* rows * cols glyph indices into ramp (texel pairs for halfblock); NULL on failure (already reported) */
+static uint8_t *build_ascii_grid(const unsigned char *pixels, int width, int height,
+                                 int cols, int rows, const AsciiRamp *ramp, int mode) {
+    uint8_t *ascii = (uint8_t *)image_cache_alloc((size_t)cols * rows * ascii_cell_bytes(mode));
+    if (!ascii) {
+        add_terminal_line("Error: Cannot allocate ASCII buffer", LINE_FLAG_ERROR);
+        return NULL;
+    }
+
+    int shape_glyphs = (mode == ASCII_MODE_SHAPE) ? ascii_shape_glyphs(ramp) : 0;
+    if (mode == ASCII_MODE_SHAPE && shape_glyphs == 0) {
+        add_terminal_line("Error: Cannot build glyph templates for mode=shape", LINE_FLAG_ERROR);
+        free(ascii);
+        return NULL;
+    }
+
+    Uint32 start = SDL_GetTicks();
+    if (!ascii_grid_fill(pixels, width, height, cols, rows, ramp, mode, ascii)) {
+        add_terminal_line("Error: Out of memory while building ASCII grid", LINE_FLAG_ERROR);
+        free(ascii);
+        return NULL;
+    }
+
+    if (mode == ASCII_MODE_SHAPE) {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "Shape matched %d × %d cells against %d glyphs (%u ms)",
+                 cols, rows, shape_glyphs, SDL_GetTicks() - start);
+        add_terminal_line(buf, LINE_FLAG_SYSTEM);
+    }
+    return ascii;
+}
+
+static const GlyphTiles *preview_glyph_tiles(const AsciiRamp *ramp, int font_size) {
+    SDL_Color color = _terminal.settings.font_color;
+    if (preview_tiles.rgba && preview_tiles_size == font_size &&
+        memcmp(&preview_tiles_color, &color, sizeof(color)) == 0 &&
+        preview_tiles_ramp.count == ramp->count &&
+        memcmp(preview_tiles_ramp.glyph, ramp->glyph, sizeof(ramp->glyph[0]) * ramp->count) == 0) {
+        return &preview_tiles;
+    }
+    glyph_tiles_free(&preview_tiles);
+
+    if (TTF_WasInit() == 0) TTF_Init();
+    TTF_Font *font = TTF_OpenFont(FONT_PATH, font_size);
+    if (!font) return NULL;
+    TTF_SetFontStyle(font, TTF_STYLE_BOLD);     // same look as terminal text
+
+    const char *strs[ASCII_RAMP_MAX];
+    for (int i = 0; i < ramp->count; i++) strs[i] = ramp->glyph[i];
+    int ok = glyph_tiles_build(&preview_tiles, font, strs, ramp->count, color);
+    TTF_CloseFont(font);
+    if (!ok) return NULL;
+
+    preview_tiles_ramp = *ramp;
+    preview_tiles_size = font_size;
+    preview_tiles_color = color;
+    return &preview_tiles;
+}
+
+/* Grid rows per texture within the renderer's limits; 0 if one row is already too wide */
+static int block_band_rows(const GlyphTiles *tiles, int cols, int rows) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(_sdl.renderer, &info) == 0) {
+        if (info.max_texture_width > 0 && cols * tiles->cell_w > info.max_texture_width) return 0;
+        if (info.max_texture_height > 0 && rows * tiles->cell_h > info.max_texture_height) {
+            return info.max_texture_height / tiles->cell_h;
+        }
+    }
+    return rows;
+}
+
+/* Static blended texture of rows * cols cells, stamped into pixels (tex_w * tex_h * 4 bytes) */
+static SDL_Texture *block_texture(const GlyphTiles *tiles, const uint8_t *cells, int cols, int rows,
+                                  uint8_t *pixels) {
+    int tex_w = cols * tiles->cell_w, tex_h = rows * tiles->cell_h;
+    GlyphStamp job = {
+        .cells = cells,
+        .cols = cols,
+        .cell_w = tiles->cell_w,
+        .cell_h = tiles->cell_h,
+        .bpp = 4,
+        .tiles = tiles->rgba,
+        .pixels = pixels,
+        .pitch = tex_w * 4,
+    };
+    run_bands(glyph_stamp_rows, &job, rows);
+
+    SDL_Texture *tex = SDL_CreateTexture(_sdl.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                         tex_w, tex_h);
+    if (!tex) return NULL;
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    SDL_UpdateTexture(tex, NULL, pixels, tex_w * 4);
+    return tex;
 }
 
+/*
+ The grid as scrollback block entries: one texture per band of rows that fits
+ the renderer's max texture height (a single one in practice). Returns the
+ number of entries added, 0 on failure.
+*/
+static int add_ascii_block(const GlyphTiles *tiles, const uint8_t *cells, int cols, int rows) {
+    int band_rows = block_band_rows(tiles, cols, rows);
+    if (band_rows <= 0) return 0;
+
+    uint8_t *pixels = (uint8_t *)malloc((size_t)cols * tiles->cell_w * band_rows * tiles->cell_h * 4);
+    if (!pixels) return 0;
+
+    int added = 0;
+    for (int row = 0; row < rows; row += band_rows) {
+        int n = rows - row < band_rows ? rows - row : band_rows;
+        SDL_Texture *tex = block_texture(tiles, cells + (size_t)row * cols, cols, n, pixels);
+        if (!tex) break;
+        add_terminal_texture_line(tex, cols * tiles->cell_w, n * tiles->cell_h, LINE_FLAG_NONE);
+        added++;
+    }
+
+    free(pixels);
+    return added;
+}
+
+/*
+ Half blocks as colored quads: one RGBA texel per half cell, stretched to the
+ cell size by the renderer (nearest, see sdl.c). One small texture holds the
+ whole grid and is simply drawn larger or smaller when the terminal resizes.
+*/
+static int add_halfblock_block(const GlyphTiles *tiles, const uint8_t *texels, int cols, int rows) {
+    SDL_Texture *tex = SDL_CreateTexture(_sdl.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                         cols, rows * 2);
+    if (!tex) return 0;
+    SDL_UpdateTexture(tex, NULL, texels, cols * 4);
+    add_terminal_texture_line(tex, cols * tiles->cell_w, rows * tiles->cell_h, LINE_FLAG_NONE);
+    return 1;
+}
+
+/*
+ palette=N on n RGBA texels (half blocks, pixel blocks): one palette index per
+ texel, fitted by k-means. NULL when off or out of memory (reported), the
+ texels then stay true color.
+*/
+static uint8_t *quantize_texels(const uint8_t *texels, size_t n, int colors, Palette *pal) {
+    if (colors <= 0) return NULL;
+
+    Uint32 start = SDL_GetTicks();
+    uint8_t *index = (uint8_t *)image_cache_alloc(n);
+    if (!index || !palette_build(pal, texels, n, colors)) {
+        add_terminal_line("Warning: Cannot fit a palette, keeping true color", LINE_FLAG_WARNING);
+        free(index);
+        return NULL;
+    }
+    palette_map(pal, texels, n, index);
 
-static void mem_write_func(void *context, void *data, int size)
-{
-    mem_writer_t *w = (mem_writer_t *)context;
-    if (size <= 0) return;
-    size_t needed = w->size + (size_t)size;
-    if (needed > w->capacity) {
-        char log[128];
-        snprintf(log, sizeof(log), "mem_write_func: overflow (need %zu, have %zu)", needed, w->capacity);
-        add_terminal_line(log, LINE_FLAG_ERROR);
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Palette: %d colors fitted to %zu texels (%u ms)", pal->count, n, SDL_GetTicks() - start);
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
+    return index;
+}
+
+/*
+ mode=pixel: the image as cols square color blocks per line, uploaded once to
+ a streaming texture and scaled up nearest-neighbor by the renderer (see
+ sdl.c), one cell width per block. Returns 0 on failure.
+*/
+static int add_pixel_art(const CachedImage *img, AsciiRamp *ramp, int cols, int font_size) {
+    Uint32 start = SDL_GetTicks();
+    int rows = (int)(((long long)cols * img->height + img->width / 2) / img->width);
+    if (rows < 1) rows = 1;
+
+    const GlyphTiles *tiles = preview_glyph_tiles(ramp, font_size);
+    uint8_t *blocks = (uint8_t *)image_cache_alloc((size_t)cols * rows * 4);
+    if (!tiles || !blocks) {
+        free(blocks);
+        return 0;
+    }
+    ascii_ramp_tone(ramp, img->pixels, img->width, img->height, rows, global_opts.tone);
+    if (!ascii_pixel_blocks(img->pixels, img->width, img->height, cols, rows, ramp->tone, blocks)) {
+        free(blocks);
+        return 0;
+    }
+
+    // The preview shows the palette the export will use
+    Palette pal;
+    uint8_t *index = quantize_texels(blocks, (size_t)cols * rows, global_opts.palette, &pal);
+    if (index) {
+        palette_expand(&pal, index, (size_t)cols * rows, blocks);
+        free(index);
+    }
+
+    // Owned by its scrollback line from here on
+    SDL_Texture *texture = SDL_CreateTexture(_sdl.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING,
+                                             cols, rows);
+    if (texture) SDL_UpdateTexture(texture, NULL, blocks, cols * 4);
+    free(blocks);
+    if (!texture) return 0;
+
+    add_terminal_texture_line(texture, cols * tiles->cell_w, rows * tiles->cell_w, LINE_FLAG_NONE);
+
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Pixel preview: %d × %d blocks, one upload (%u ms)", cols, rows, SDL_GetTicks() - start);
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
+    return 1;
+}
+
+static void report_preview(int cols, int rows, int blocks, Uint32 start) {
+    char debug[128];
+    snprintf(debug, sizeof(debug), "Rendered %d × %d chars as %d block%s (%u ms)",
+             cols, rows, blocks, blocks == 1 ? "" : "s", SDL_GetTicks() - start);
+    add_terminal_line("\n", LINE_FLAG_NONE);
+    add_terminal_line(debug, LINE_FLAG_SYSTEM);
+    add_terminal_line("\n", LINE_FLAG_NONE);
+}
+
+/*
+ Progressive preview: a coarse grid goes up at once, stretched to the final
+ size, and the full grid is filled over the next frames and swapped into the
+ same scrollback entry.
+*/
+static struct {
+    int active;
+    const CachedImage *img;     /* pinned until the job ends */
+    AsciiRamp ramp;
+    AsciiGridJob job;
+    uint8_t *cells;
+    int font_size;
+    SDL_Texture *coarse;
+    Uint32 started;
+} preview;
+
+static TerminalLine *find_preview_line(void) {
+    for (int i = 0; i < _terminal.line_count; i++) {
+        TerminalLine *line = &_terminal.lines[i];
+        if ((line->flags & LINE_FLAG_REFINING) && line->texture == preview.coarse) return line;
+    }
+    return NULL;
+}
+
+/* Rows per step: a row per worker for shape matching, a batch of cheap rows otherwise */
+static int preview_step_rows(void) {
+    return preview.job.mode == ASCII_MODE_SHAPE ? worker_count() : 16;
+}
+
+/* Step the grid until done or out of time; rows left, -1 on failure */
+static int preview_fill(Uint32 budget_ms) {
+    Uint32 start = SDL_GetTicks();
+    int left;
+    do {
+        left = ascii_grid_step(&preview.job, preview_step_rows());
+    } while (left > 0 && SDL_GetTicks() - start < budget_ms);
+    return left;
+}
+
+int ascii_preview_active(void) {
+    return preview.active;
+}
+
+void ascii_preview_cancel(void) {
+    if (!preview.active) return;
+
+    // A coarse grid left behind just stays as it is
+    TerminalLine *line = find_preview_line();
+    if (line) line->flags &= ~LINE_FLAG_REFINING;
+
+    ascii_grid_end(&preview.job);
+    free(preview.cells);
+    image_cache_unpin(preview.img);
+    memset(&preview, 0, sizeof(preview));
+}
+
+/*
+ Start the preview of a toned ramp. Returns 0 when it has to take the
+ synchronous path instead (several texture bands, or a failure that path
+ reports).
+*/
+static int preview_start(const CachedImage *img, const AsciiRamp *ramp, int mode,
+                         int cols, int rows, int font_size) {
+    ascii_preview_cancel();
+
+    const GlyphTiles *tiles = preview_glyph_tiles(ramp, font_size);
+    if (!tiles || block_band_rows(tiles, cols, rows) < rows) return 0;
+
+    // Held until ascii_preview_cancel; the cells allocation may flush the cache
+    image_cache_pin(img);
+    preview.ramp = *ramp;
+    preview.cells = (uint8_t *)image_cache_alloc((size_t)cols * rows);
+    if (!preview.cells ||
+        !ascii_grid_begin(&preview.job, img->pixels, img->width, img->height, cols, rows,
+                          &preview.ramp, mode, preview.cells)) {
+        free(preview.cells);
+        memset(&preview, 0, sizeof(preview));
+        image_cache_unpin(img);
+        return 0;
+    }
+    preview.img = img;
+    preview.font_size = font_size;
+    preview.started = SDL_GetTicks();
+    preview.active = 1;
+
+    // Small grids are done within the first slice and skip the coarse pass
+    int left = preview_fill(PREVIEW_SLICE_MS);
+    if (left < 0) {
+        ascii_preview_cancel();
+        return 0;
+    }
+    if (left == 0) {
+        int blocks = add_ascii_block(tiles, preview.cells, cols, rows);
+        Uint32 started = preview.started;
+        ascii_preview_cancel();
+        if (blocks == 0) return 0;
+        report_preview(cols, rows, blocks, started);
+        return 1;
+    }
+
+    int coarse_cols = cols / PREVIEW_COARSE_DIV > 0 ? cols / PREVIEW_COARSE_DIV : 1;
+    int coarse_rows = ascii_grid_rows(img->width, img->height, coarse_cols, ASCII_PREVIEW_ASPECT);
+    if (coarse_rows > rows) coarse_rows = rows;
+    uint8_t *coarse = (uint8_t *)image_cache_alloc((size_t)coarse_cols * coarse_rows);
+    uint8_t *pixels = (uint8_t *)image_cache_alloc((size_t)coarse_cols * tiles->cell_w * coarse_rows * tiles->cell_h * 4);
+    if (coarse && pixels &&
+        ascii_grid_fill(img->pixels, img->width, img->height, coarse_cols, coarse_rows, &preview.ramp, mode, coarse)) {
+        preview.coarse = block_texture(tiles, coarse, coarse_cols, coarse_rows, pixels);
+    }
+    free(coarse);
+    free(pixels);
+
+    if (!preview.coarse) {
+        // No placeholder: finish now, like the synchronous path
+        left = preview_fill(~0u);
+        int blocks = left == 0 ? add_ascii_block(tiles, preview.cells, cols, rows) : 0;
+        Uint32 started = preview.started;
+        ascii_preview_cancel();
+        if (blocks == 0) return 0;
+        report_preview(cols, rows, blocks, started);
+        return 1;
+    }
+    add_terminal_texture_line(preview.coarse, cols * tiles->cell_w, rows * tiles->cell_h, LINE_FLAG_REFINING);
+    return 1;
+}
+
+void ascii_preview_tick(void) {
+    if (!preview.active) return;
+
+    // Scrolled out of the FIFO or cleared: nothing left to refine
+    TerminalLine *line = find_preview_line();
+    if (!line) {
+        ascii_preview_cancel();
+        return;
+    }
+
+    int left = preview_fill(PREVIEW_SLICE_MS);
+    if (left > 0) return;
+    if (left < 0) {
+        add_terminal_line("Warning: out of memory, preview left coarse", LINE_FLAG_WARNING);
+        ascii_preview_cancel();
         return;
     }
-    memcpy(w->buf + w->size, data, (size_t)size);
-    w->size += (size_t)size;
+
+    int cols = preview.job.cols, rows = preview.job.rows;
+    const GlyphTiles *tiles = preview_glyph_tiles(&preview.ramp, preview.font_size);
+    uint8_t *pixels = tiles ? (uint8_t *)image_cache_alloc((size_t)cols * tiles->cell_w * rows * tiles->cell_h * 4) : NULL;
+    SDL_Texture *tex = pixels ? block_texture(tiles, preview.cells, cols, rows, pixels) : NULL;
+    free(pixels);
+
+    if (tex) {
+        SDL_DestroyTexture(line->texture);
+        line->texture = tex;
+        preview.coarse = tex;
+        _terminal.dirty = TRUE;
+        report_preview(cols, rows, 1, preview.started);
+    } else {
+        add_terminal_line("Warning: cannot render the full preview, left coarse", LINE_FLAG_WARNING);
+    }
+    ascii_preview_cancel();
 }
 
-void export_ascii(unsigned char *raw_data, int raw_size, ExportOptions opts) {
+/* The grid as TXT / ANSI / HTML, streamed out in chunks; nothing is rasterized */
+static void export_text(const AsciiRamp *ramp, const uint8_t *cells, int cols, int rows, const ExportOptions *opts) {
+    char buf[160];
+    const char *name = ascii_format_name(opts->format);
+    Uint32 start = SDL_GetTicks();
+#ifdef __EMSCRIPTEN__
+    EM_ASM({ Module.rekavBlobParts = []; });
+    size_t size = ascii_write_text(ramp, opts->mode, cells, cols, rows, opts->format, opts->fg, opts->bg,
+                                   blob_part_sink, NULL);
+#else
+    FILE *out = fopen(opts->filename, "wb");
+    size_t size = out ? ascii_write_text(ramp, opts->mode, cells, cols, rows, opts->format, opts->fg, opts->bg,
+                                         png_file_sink, out) : 0;
+    if (out) fclose(out);
+#endif
+
+    if (size == 0) {
+        snprintf(buf, sizeof(buf), "%s export FAILED - download skipped", name);
+        add_terminal_line(buf, LINE_FLAG_ERROR);
+#ifdef __EMSCRIPTEN__
+        EM_ASM({ Module.rekavBlobParts = null; });
+#endif
+        return;
+    }
+
+    snprintf(buf, sizeof(buf), "%s written OK, size: %zu bytes (%u ms)", name, size, SDL_GetTicks() - start);
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
+#ifdef __EMSCRIPTEN__
+    download_blob_parts(opts->filename, opts->format == ASCII_FORMAT_HTML ? "text/html;charset=utf-8"
+                                                                          : "text/plain;charset=utf-8");
+    add_terminal_line("Download triggered!", LINE_FLAG_SYSTEM);
+#else
+    snprintf(buf, sizeof(buf), "Saved to %s", opts->filename);
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
+#endif
+}
+
+/* Indexed glyph PNG, true color for half blocks, or indexed from their palette */
+static size_t write_grid_png(const AsciiTileset *ts, int mode, const uint8_t *cells, const uint8_t *index,
+                             const Palette *pal, int cols, int rows, int level, png_sink_func sink, void *ctx) {
+    if (index) {
+        return ascii_write_halfblock_indexed_png(index, cols, rows, ts->cell_w, ts->cell_h, pal, level, sink, ctx);
+    }
+    if (mode == ASCII_MODE_HALFBLOCK) {
+        return ascii_write_halfblock_png(cells, cols, rows, ts->cell_w, ts->cell_h, level, sink, ctx);
+    }
+    return ascii_write_png(ts, cells, cols, rows, level, sink, ctx);
+}
+
+void export_ascii(const CachedImage *img, ExportOptions opts) {
     add_terminal_line("\n", LINE_FLAG_NONE);
-    add_terminal_line("export_ascii: starting ASCII PNG export...", LINE_FLAG_SYSTEM);
+    opts.mode = ascii_export_mode(opts.mode);
 
     char buf[256];
+    snprintf(buf, sizeof(buf), "export_ascii: starting ASCII %s export...", ascii_format_name(opts.format));
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
+
     add_terminal_line("User options (opts):", LINE_FLAG_SYSTEM);
     snprintf(buf, sizeof(buf), "  chars_wide:   %d", opts.chars_wide);
     add_terminal_line(buf, LINE_FLAG_NONE);
@@ -67,19 +529,21 @@ void export_ascii(unsigned char *raw_data, int raw_size, ExportOptions opts) {
     add_terminal_line(buf, LINE_FLAG_NONE);
     snprintf(buf, sizeof(buf), "  filename:     %s", opts.filename ? opts.filename : "(null)");
     add_terminal_line(buf, LINE_FLAG_NONE);
+    snprintf(buf, sizeof(buf), "  png level:    %d", opts.png_level);
+    add_terminal_line(buf, LINE_FLAG_NONE);
+    snprintf(buf, sizeof(buf), "  png bits:     %d%s", opts.png_bits, opts.png_bits ? "" : " (auto)");
+    add_terminal_line(buf, LINE_FLAG_NONE);
+    snprintf(buf, sizeof(buf), "  mode:         %s", ascii_mode_name(opts.mode));
+    add_terminal_line(buf, LINE_FLAG_NONE);
+    snprintf(buf, sizeof(buf), "  tone:         %s", tone_name(opts.tone));
+    add_terminal_line(buf, LINE_FLAG_NONE);
+    snprintf(buf, sizeof(buf), "  format:       %s", ascii_format_name(opts.format));
+    add_terminal_line(buf, LINE_FLAG_NONE);
+    snprintf(buf, sizeof(buf), "  palette:      %d%s", opts.palette, opts.palette ? "" : " (true color)");
+    add_terminal_line(buf, LINE_FLAG_NONE);
 
-    if (raw_size <= 0 || raw_size > 20 * 1024 * 1024) {
-        add_terminal_line("export_ascii: invalid image size", LINE_FLAG_ERROR);
-        return;
-    }
-
-    int width, height, channels;
-    unsigned char *pixels = stbi_load_from_memory(raw_data, raw_size, &width, &height, &channels, 4);
-    if (!pixels) {
-        add_terminal_line("export_ascii: stbi_load_from_memory failed", LINE_FLAG_ERROR);
-        return;
-    }
-    add_terminal_line("Image loaded OK", LINE_FLAG_SYSTEM);
+    const unsigned char *pixels = img->pixels;
+    int width = img->width, height = img->height;
 
     int target_width = opts.chars_wide;
     if (target_width <= 0 || target_width > 500) {
@@ -88,7 +552,7 @@ void export_ascii(unsigned char *raw_data, int raw_size, ExportOptions opts) {
         add_terminal_line(buf, LINE_FLAG_SYSTEM);
     }
 
-    const float char_aspect = 2.2f;
+    const float char_aspect = ASCII_EXPORT_ASPECT;
     int target_height = (int)((float)(height * target_width) / (float)width / char_aspect);
     if (target_height <= 0 || target_height > 1000) {
         target_height = 50;  // sane default
@@ -99,389 +563,394 @@ void export_ascii(unsigned char *raw_data, int raw_size, ExportOptions opts) {
     snprintf(buf, sizeof(buf), "Target dimensions: %d chars wide × %d chars high", target_width, target_height);
     add_terminal_line(buf, LINE_FLAG_NONE);
 
-    const char *ramp = opts.ramp;
-    int ramp_len = strlen(ramp);
-
-    size_t buf_size = (target_width + 1LL) * target_height + 1;
-    char *ascii = (char *)malloc(buf_size);
-    if (!ascii) {
-        add_terminal_line("malloc failed for ASCII buffer", LINE_FLAG_ERROR);
-        stbi_image_free(pixels);
+    AsciiRamp ramp;
+    if (!ascii_ramp_for_mode(&ramp, opts.ramp, opts.mode)) {
+        add_terminal_line("export_ascii: empty ramp", LINE_FLAG_ERROR);
         return;
     }
-    char *p = ascii;
+    ascii_ramp_tone(&ramp, pixels, width, height, target_height, opts.tone);
 
-    float *error = (float *)calloc(target_width + 4, sizeof(float));
-    float *next_row = (float *)calloc(target_width + 4, sizeof(float));
-    if (!error || !next_row) {
-        add_terminal_line("malloc failed for dithering arrays", LINE_FLAG_ERROR);
-        free(ascii);
-        if (error) free(error);
-        if (next_row) free(next_row);
-        stbi_image_free(pixels);
-        return;
-    }
-
-    for (int y = 0; y < target_height; y++) {
-        for (int x = 0; x < target_width; x++) {
-            int sx = (x * width) / target_width;
-            int sy = (y * height) / target_height;
-            unsigned char *px = pixels + (sy * width + sx) * 4;
-
-            float r = px[0], g = px[1], b = px[2];
-            float gray = 0.299f*r + 0.587f*g + 0.114f*b + error[x+1];
-
-            if (gray < 0) gray = 0;
-            if (gray > 255) gray = 255;
+    uint8_t *ascii = build_ascii_grid(pixels, width, height, target_width, target_height, &ramp, opts.mode);
+    if (!ascii) return;
 
-            int idx = (int)(gray * ramp_len / 256.0f);
-            if (idx >= ramp_len) idx = ramp_len-1;
-            if (idx < 0) idx = 0;
+    add_terminal_line("ASCII art generated OK", LINE_FLAG_SYSTEM);
 
-            *p++ = ramp[idx];
+    Palette pal;
+    uint8_t *index = opts.mode == ASCII_MODE_HALFBLOCK
+                   ? quantize_texels(ascii, (size_t)target_width * target_height * 2, opts.palette, &pal) : NULL;
 
-            float quant_error = gray - (idx * 255.0f / (ramp_len-1));
-            error[x+1]      += quant_error * 7.0f/16.0f;
-            next_row[x]      += quant_error * 3.0f/16.0f;
-            next_row[x+1]    += quant_error * 5.0f/16.0f;
-            next_row[x+2]    += quant_error * 1.0f/16.0f;
-        }
-        *p++ = '\n';
-        memcpy(error, next_row, (target_width+4)*sizeof(float));
-        memset(next_row, 0, (target_width+4)*sizeof(float));
+    if (opts.format != ASCII_FORMAT_PNG) {
+        // Text keeps colors per cell: the palette colors, so runs get longer
+        if (index) palette_expand(&pal, index, (size_t)target_width * target_height * 2, ascii);
+        export_text(&ramp, ascii, target_width, target_height, &opts);
+        free(index);
+        free(ascii);
+        return;
     }
-    free(error);
-    free(next_row);
-    *p = '\0';
-
-    add_terminal_line("ASCII art generated OK", LINE_FLAG_SYSTEM);
 
     if (TTF_WasInit() == 0) TTF_Init();
     TTF_Font *font = TTF_OpenFont(FONT_PATH, opts.font_size);
     if (!font) {
         add_terminal_line("export_ascii: failed to load font", LINE_FLAG_ERROR);
+        free(index);
         free(ascii);
-        stbi_image_free(pixels);
         return;
     }
     add_terminal_line("Font opened OK", LINE_FLAG_SYSTEM);
 
-    int char_width, char_height;
-    TTF_SizeUTF8(font, "A", &char_width, NULL);
-    char_height = TTF_FontLineSkip(font);
-
-    int img_width  = target_width * char_width;
-    int img_height = target_height * char_height;
-
-    if (img_width <= 0 || img_height <= 0) {
-        add_terminal_line("Error: invalid final image dimensions (w/h <= 0)", LINE_FLAG_ERROR);
-        TTF_CloseFont(font);
-        free(ascii);
-        stbi_image_free(pixels);
-        return;
-    }
-
-    snprintf(buf, sizeof(buf), "Creating surface: %d × %d pixels", img_width, img_height);
-    add_terminal_line(buf, LINE_FLAG_NONE);
-
-    SDL_Surface *final_surf = SDL_CreateRGBSurfaceWithFormat(0, img_width, img_height, 32, SDL_PIXELFORMAT_RGBA32);
-    if (!final_surf) {
-        add_terminal_line("SDL_CreateRGBSurfaceWithFormat failed", LINE_FLAG_ERROR);
-        TTF_CloseFont(font);
+    // Half blocks only take the cell size from it
+    AsciiTileset tileset;
+    int tiles_ok = ascii_tileset_build(&tileset, font, &ramp, opts.fg, opts.bg, opts.png_bits);
+    TTF_CloseFont(font);
+    if (!tiles_ok) {
+        add_terminal_line("export_ascii: glyph rasterization failed", LINE_FLAG_ERROR);
+        free(index);
         free(ascii);
-        stbi_image_free(pixels);
         return;
     }
 
-    if (final_surf->pixels == NULL || final_surf->pitch <= 0) {
-        add_terminal_line("Error: final_surf is empty or invalid (pixels NULL or pitch <=0)", LINE_FLAG_ERROR);
-        SDL_FreeSurface(final_surf);
-        TTF_CloseFont(font);
-        free(ascii);
-        stbi_image_free(pixels);
-        return;
+    if (index) {
+        snprintf(buf, sizeof(buf), "Encoding PNG: %d × %d pixels, %d-bit indexed (%d colors), level %d",
+                 target_width * tileset.cell_w, target_height * tileset.cell_h,
+                 palette_bits(&pal), pal.count, opts.png_level);
+    } else if (opts.mode == ASCII_MODE_HALFBLOCK) {
+        snprintf(buf, sizeof(buf), "Encoding PNG: %d × %d pixels, 24-bit RGB, level %d",
+                 target_width * tileset.cell_w, target_height * tileset.cell_h, opts.png_level);
+    } else {
+        snprintf(buf, sizeof(buf), "Encoding PNG: %d × %d pixels, %d-bit indexed (%d colors), level %d",
+                 target_width * tileset.cell_w, target_height * tileset.cell_h,
+                 tileset.bits, tileset.palette_size, opts.png_level);
     }
+    add_terminal_line(buf, LINE_FLAG_NONE);
 
-    SDL_FillRect(final_surf, NULL, SDL_MapRGBA(final_surf->format, opts.bg[0], opts.bg[1], opts.bg[2], 255));
-
-    int y_offset = 0;
-    char *line = ascii;
-    while (*line) {
-        char *nl = strchr(line, '\n');
-        if (!nl) nl = line + strlen(line);
-        int len = nl - line;
-        char tmp[1024];
-        if (len >= sizeof(tmp)) len = sizeof(tmp)-1;
-        strncpy(tmp, line, len);
-        tmp[len] = '\0';
-
-        SDL_Color fg = {opts.fg[0], opts.fg[1], opts.fg[2], 255};
-        SDL_Surface *surf = TTF_RenderUTF8_Blended(font, tmp, fg);
-        if (surf) {
-            SDL_Rect dst = {0, y_offset, surf->w, surf->h};
-            SDL_BlitSurface(surf, NULL, final_surf, &dst);
-            SDL_FreeSurface(surf);
-        }
-        y_offset += char_height;
-        line = (*nl) ? nl+1 : nl;
-    }
+    Uint32 encode_start = SDL_GetTicks();
+#ifdef __EMSCRIPTEN__
+    EM_ASM({ Module.rekavBlobParts = []; });
+    size_t png_size = write_grid_png(&tileset, opts.mode, ascii, index, &pal, target_width, target_height,
+                                     opts.png_level, blob_part_sink, NULL);
+#else
+    FILE *out = fopen(opts.filename, "wb");
+    size_t png_size = out ? write_grid_png(&tileset, opts.mode, ascii, index, &pal, target_width, target_height,
+                                           opts.png_level, png_file_sink, out) : 0;
+    if (out) fclose(out);
+#endif
 
-    add_terminal_line("Text rendered to surface OK", LINE_FLAG_SYSTEM);
+    ascii_tileset_free(&tileset);
+    free(index);
+    free(ascii);
 
-    mem_writer_t writer = {0};
-    writer.buf = malloc(MAX_PNG_SIZE);
-    writer.size = 0;
-    writer.capacity = MAX_PNG_SIZE;
-    if (!writer.buf) {
-        add_terminal_line("malloc for PNG buffer failed", LINE_FLAG_ERROR);
-        SDL_FreeSurface(final_surf);
-        TTF_CloseFont(font);
-        free(ascii);
-        stbi_image_free(pixels);
+    if (png_size == 0) {
+        add_terminal_line("PNG encoding FAILED - download skipped", LINE_FLAG_ERROR);
+#ifdef __EMSCRIPTEN__
+        EM_ASM({ Module.rekavBlobParts = null; });
+#endif
         return;
     }
 
-    int write_result = stbi_write_png_to_func(mem_write_func, &writer, final_surf->w, final_surf->h, 4, final_surf->pixels, final_surf->pitch);
+    snprintf(buf, sizeof(buf), "PNG written OK, size: %zu bytes (%u ms)", png_size, SDL_GetTicks() - encode_start);
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
 
-    if (write_result == 0) {
-        add_terminal_line("stbi_write_png_to_func FAILED", LINE_FLAG_ERROR);
-    } else {
-        snprintf(buf, sizeof(buf), "PNG written OK, size: %zu bytes", writer.size);
-        add_terminal_line(buf, LINE_FLAG_SYSTEM);
-    }
-
-    SDL_FreeSurface(final_surf);
-    TTF_CloseFont(font);
-    free(ascii);
-    stbi_image_free(pixels);
-
-    if (writer.size > 0) {
-        EM_ASM_({
-            const dataPtr = $0;
-            const dataLen = $1;
-            const filename = UTF8ToString($2);
-            const bytes = new Uint8Array(Module.HEAPU8.buffer, dataPtr, dataLen);
-            const blob = new Blob([bytes], {type:"image/png"});
-            const url = URL.createObjectURL(blob);
-            const a = document.createElement("a");
-            a.href = url;
-            a.download = filename;
-            a.click();
-            URL.revokeObjectURL(url);
-        }, writer.buf, writer.size, opts.filename);
-
-        add_terminal_line("PNG download triggered!", LINE_FLAG_SYSTEM);
-    } else {
-        add_terminal_line("No data written to PNG - download skipped", LINE_FLAG_ERROR);
-    }
-
-    free(writer.buf);
+#ifdef __EMSCRIPTEN__
+    download_blob_parts(opts.filename, "image/png");
+    add_terminal_line("PNG download triggered!", LINE_FLAG_SYSTEM);
+#else
+    snprintf(buf, sizeof(buf), "PNG saved to %s", opts.filename);
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
+#endif
 }
 
-void process_image_to_pixels(unsigned char *raw_data, int raw_size) {
+void process_image_to_pixels(const CachedImage *img) {
     add_terminal_line("\n", LINE_FLAG_SYSTEM);
     add_terminal_line("Starting ASCII art Generation preview...", LINE_FLAG_SYSTEM);
 
-    if (raw_size <= 0 || raw_size > 20 * 1024 * 1024) {
-        add_terminal_line("Error: Invalid image size", LINE_FLAG_ERROR);
-        reset_current_input();
+    ascii_preview_cancel();
+    ascii_view_stop();
+
+    int target_width = preview_cols();
+    int font_size = global_opts.font_size ? global_opts.font_size : 8;
+    if(font_size >= 9) font_size = 9;
+    const float char_aspect = ASCII_PREVIEW_ASPECT;
+    AsciiRamp ramp;
+    if (!ascii_ramp_for_mode(&ramp, global_opts.ramp ? global_opts.ramp : RAMP_1, global_opts.mode)) {
+        add_terminal_line("Error: Empty ramp", LINE_FLAG_ERROR);
         return;
     }
 
-    int width, height, channels;
-    unsigned char *pixels = stbi_load_from_memory(raw_data, raw_size, &width, &height, &channels, 4);
-    if (!pixels) {
-        add_terminal_line("Error: Failed to decode image", LINE_FLAG_ERROR);
-        reset_current_input();
+    // Animated GIFs play in place instead of printing their first frame (color modes show the first frame)
+    if (!ascii_mode_color(global_opts.mode) && img->source && ascii_anim_is_gif(img->source, img->source_size) &&
+        ascii_anim_start(img->source, img->source_size, target_width, char_aspect, font_size, &ramp,
+                         global_opts.mode, global_opts.tone)) {
         return;
     }
 
-    char info[128];
-    snprintf(info, sizeof(info), "Image decoded: %d × %d (%d ch)", width, height, channels);
-    add_terminal_line(info, LINE_FLAG_SYSTEM);
+    if (global_opts.view) {
+        ascii_view_start(img, target_width, char_aspect, font_size, global_opts.ramp ? global_opts.ramp : RAMP_1,
+                         global_opts.mode, global_opts.tone);
+        return;
+    }
 
-    int target_width = global_opts.chars_wide ? global_opts.chars_wide : 130;
-    int font_size = global_opts.font_size ? global_opts.font_size : 8;
-    if(font_size >= 9) font_size = 9;
-    const float char_aspect = 1.6f;
-    int target_height = (int)((float)(height * target_width) / (float)width / char_aspect);
+    if (global_opts.mode == ASCII_MODE_PIXEL) {
+        if (!add_pixel_art(img, &ramp, target_width, font_size)) {
+            add_terminal_line("Error: Cannot render pixel preview", LINE_FLAG_ERROR);
+        }
+        return;
+    }
+
+    const unsigned char *pixels = img->pixels;
+    int width = img->width, height = img->height;
+    int target_height = ascii_grid_rows(width, height, target_width, char_aspect);
 
     char size_dbg[128];
     snprintf(size_dbg, sizeof(size_dbg), "Target size: %d wide × %d high (aspect %.1f)", target_width, target_height, char_aspect);
     add_terminal_line(size_dbg, LINE_FLAG_SYSTEM);
     add_terminal_line("\n", LINE_FLAG_NONE);
 
-    const char *ramp = global_opts.ramp ? global_opts.ramp : RAMP_1;
-    int ramp_len = strlen(ramp);
+    ascii_ramp_tone(&ramp, pixels, width, height, target_height, global_opts.tone);
+    int halfblock = global_opts.mode == ASCII_MODE_HALFBLOCK;
+    if (!halfblock && preview_start(img, &ramp, global_opts.mode, target_width, target_height, font_size)) return;
 
-    size_t buf_size = (target_width + 1LL) * target_height + 1;
-    char *ascii = (char *)malloc(buf_size);
-    if (!ascii) {
-        add_terminal_line("Error: Cannot allocate ASCII buffer", LINE_FLAG_ERROR);
-        stbi_image_free(pixels);
+    uint8_t *ascii = build_ascii_grid(pixels, width, height, target_width, target_height, &ramp, global_opts.mode);
+    if (!ascii) return;
+
+    // The preview shows the palette the export will use
+    Palette pal;
+    uint8_t *index = halfblock
+                   ? quantize_texels(ascii, (size_t)target_width * target_height * 2, global_opts.palette, &pal) : NULL;
+    if (index) {
+        palette_expand(&pal, index, (size_t)target_width * target_height * 2, ascii);
+        free(index);
+    }
+
+    // Composed from cached glyph tiles: one scrollback entry, the terminal font is left alone
+    Uint32 start = SDL_GetTicks();
+    const GlyphTiles *tiles = preview_glyph_tiles(&ramp, font_size);
+    int blocks = !tiles ? 0
+               : halfblock ? add_halfblock_block(tiles, ascii, target_width, target_height)
+               : add_ascii_block(tiles, ascii, target_width, target_height);
+    free(ascii);
+
+    if (blocks == 0) {
+        char debug[128];
+        snprintf(debug, sizeof(debug), "Error: Cannot render %d × %d preview (try a smaller wide=)", target_width, target_height);
+        add_terminal_line(debug, LINE_FLAG_ERROR);
         return;
     }
-    char *p = ascii;
-
-    float *error = (float *)calloc(target_width + 4, sizeof(float));
-    float *next_row = (float *)calloc(target_width + 4, sizeof(float));
-
-    for (int y = 0; y < target_height; y++) {
-        for (int x = 0; x < target_width; x++) {
-            int sx = (x * width) / target_width;
-            int sy = (y * height) / target_height;
-            unsigned char *px = pixels + (sy * width + sx) * 4;
-            float r = px[0], g = px[1], b = px[2];
-            float gray = 0.299f * r + 0.587f * g + 0.114f * b + error[x + 1];
-            if (gray < 0) gray = 0;
-            if (gray > 255) gray = 255;
-            int idx = (int)(gray * ramp_len / 256.0f);
-            if (idx >= ramp_len) idx = ramp_len - 1;
-            if (idx < 0) idx = 0;
-            *p++ = ramp[idx];
-            float quant_error = gray - (idx * 255.0f / (ramp_len - 1));
-            error[x + 1] += quant_error * 7.0f / 16.0f;
-            next_row[x] += quant_error * 3.0f / 16.0f;
-            next_row[x + 1] += quant_error * 5.0f / 16.0f;
-            next_row[x + 2] += quant_error * 1.0f / 16.0f;
+    report_preview(target_width, target_height, blocks, start);
+}
+
+/*
+ Admission from the header, before any pixel is allocated. The scaled JPEG
+ decoder also holds its planes, about one more byte per output pixel and
+ component.
+*/
+static int admit_decode(int full_w, int full_h, int scale, int color) {
+    size_t out_w = (full_w + scale - 1) / scale, out_h = (full_h + scale - 1) / scale;
+    size_t need = out_w * out_h * (scale > 1 ? (color ? 7 : 5) : 4);
+    if (pipeline_admit(need)) return 1;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "Error: %d × %d image needs %zu MB, over the %zu MB budget (to_ascii mem=<MB>)",
+             full_w, full_h, (need + 0xFFFFF) >> 20, pipeline_budget() >> 20);
+    add_terminal_line(msg, LINE_FLAG_ERROR);
+    return 0;
+}
+
+/* Source width worth decoding for the preview: all of it when the viewer may zoom in */
+static int wanted_source_width(int full_w) {
+    return global_opts.view ? full_w : ascii_source_width(preview_cols(), global_opts.mode);
+}
+
+/* Decode encoded bytes into the image cache; NULL on failure (already reported) */
+static const CachedImage *decode_into_cache(uint64_t key, const unsigned char *raw, int raw_size) {
+    // Large JPEGs are decoded straight to the scale the grid needs, luma only unless the mode shows color
+    int color = ascii_mode_color(global_opts.mode);
+    int full_w, full_h, channels = 1, scale = 1;
+    if (jpeg_info(raw, raw_size, &full_w, &full_h)) {
+        scale = jpeg_pick_scale(full_w, wanted_source_width(full_w));
+    } else if (!stbi_info_from_memory(raw, raw_size, &full_w, &full_h, &channels)) {
+        add_terminal_line("Error: Failed to decode image (unknown format)", LINE_FLAG_ERROR);
+        return NULL;
+    }
+
+    if (!admit_decode(full_w, full_h, scale, color)) return NULL;
+
+    Uint32 start = SDL_GetTicks();
+    int width, height;
+    unsigned char *pixels = NULL;
+    char info[128];
+    if (scale > 1) {
+        pixels = jpeg_decode(raw, raw_size, scale, color ? 0 : JPEG_GRAY, &width, &height);
+        snprintf(info, sizeof(info), "JPEG decoded at 1/%d: %d × %d (%s, %u ms)", scale, width, height,
+                 color ? "color" : "luma", SDL_GetTicks() - start);
+    }
+    if (!pixels) {
+        // Full size, or a JPEG the scaled decoder refuses (admitted again at full size)
+        if (scale > 1 && !admit_decode(full_w, full_h, 1, color)) return NULL;
+        scale = 1;
+        pixels = stbi_load_from_memory(raw, raw_size, &width, &height, &channels, 4);
+        if (!pixels && image_cache_count() > 0 && strcmp(stbi_failure_reason(), "outofmem") == 0) {
+            // Memory pressure: cached images go first
+            image_cache_flush();
+            pixels = stbi_load_from_memory(raw, raw_size, &width, &height, &channels, 4);
         }
-        *p++ = '\n';
-        memcpy(error, next_row, (target_width + 4) * sizeof(float));
-        memset(next_row, 0, (target_width + 4) * sizeof(float));
-    }
-
-    free(error);
-    free(next_row);
-    *p = '\0';
-
-    p = ascii;
-    char line_buf[1024];
-    int printed = 0;
-    int prev_font_size = _terminal.settings.font_size;
-    set_font_size(&_terminal.settings, font_size);
-
-    while (*p) {
-        char *nl = strchr(p, '\n');
-        if (nl) {
-            size_t len = nl - p;
-            if (len >= sizeof(line_buf)) len = sizeof(line_buf) - 1;
-            strncpy(line_buf, p, len);
-            line_buf[len] = '\0';
-            add_terminal_line(line_buf, LINE_FLAG_NONE);
-            printed++;
-            p = nl + 1;
-        } else {
-            add_terminal_line(p, LINE_FLAG_NONE);
-            printed++;
-            break;
+        if (!pixels) {
+            add_terminal_line("Error: Failed to decode image", LINE_FLAG_ERROR);
+            return NULL;
         }
+        snprintf(info, sizeof(info), "Image decoded: %d × %d (%d ch, %u ms)", width, height, channels, SDL_GetTicks() - start);
     }
+    add_terminal_line(info, LINE_FLAG_SYSTEM);
 
-    set_font_size(&_terminal.settings, prev_font_size);
+    // GIFs keep their bytes for playback, scaled JPEGs for a finer decode later
+    int keep = scale > 1 || ascii_anim_is_gif(raw, raw_size);
+    const CachedImage *img = image_cache_put(key, pixels, width, height, keep ? raw : NULL, keep ? raw_size : 0,
+                                             scale, scale > 1 && !color);
+    if (!img) add_terminal_line("Error: Cannot keep decoded image", LINE_FLAG_ERROR);
+    return img;
+}
 
-    char debug[128];
-    snprintf(debug, sizeof(debug), "Printed %d lines (expected ~%d)", printed, target_height);
-    add_terminal_line("\n", LINE_FLAG_NONE);
-    add_terminal_line(debug, LINE_FLAG_SYSTEM);
-    add_terminal_line("\n", LINE_FLAG_NONE);
+/* Preview, then the PNG export when download=1 was asked for */
+static void convert_image(const CachedImage *img) {
+    // Allocations below may flush the cache; img has to outlive them
+    image_cache_pin(img);
+    process_image_to_pixels(img);
+    if (_image_download_pending) {
+        export_ascii(img, global_opts);
+    }
+    image_cache_unpin(img);
+    _image_download_pending = 0;
+    reset_current_input();
+}
 
-    free(ascii);
-    stbi_image_free(pixels);
+int ascii_convert_cached(const char *url) {
+    pending_key = image_cache_key(url);
+    const CachedImage *img = image_cache_get(pending_key);
+    if (!img) return 0;
+
+    // Decoded smaller than this grid can use, or without the color it shows: decode the kept JPEG bytes again
+    int full_w, full_h;
+    if (img->scale > 1 && img->source && jpeg_info(img->source, img->source_size, &full_w, &full_h) &&
+        (jpeg_pick_scale(full_w, wanted_source_width(full_w)) < img->scale ||
+         (img->gray && ascii_mode_color(global_opts.mode)))) {
+        image_cache_pin(img);
+        const CachedImage *finer = decode_into_cache(pending_key, img->source, img->source_size);
+        image_cache_unpin(img);
+        if (!finer) return 0;       // fetch it again
+        img = finer;
+    }
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Image cache hit: %d × %d, no refetch", img->width, img->height);
+    add_terminal_line(msg, LINE_FLAG_SYSTEM);
+    convert_image(img);
+    return 1;
 }
 
-void parse_color(const char *name, uint8_t *r, uint8_t *g, uint8_t *b) {
-    if (strcmp(name, "black") == 0) { *r=0; *g=0; *b=0; }
-    else if (strcmp(name, "white") == 0) { *r=255; *g=255; *b=255; }
-    else if (strcmp(name, "red") == 0) { *r=255; *g=0; *b=0; }
-    else if (strcmp(name, "green") == 0) { *r=0; *g=255; *b=0; }
-    else if (strcmp(name, "blue") == 0) { *r=0; *g=0; *b=255; }
-    else if (strcmp(name, "pink") == 0) { *r=255; *g=192; *b=203; }
-    else if (strcmp(name, "purple") == 0) { *r=128; *g=0; *b=128; }
-    else { *r=255; *g=255; *b=255; } // default white
+int ascii_convert_file(const char *path) {
+    char msg[160];
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        snprintf(msg, sizeof(msg), "Error: No such file: %s (or give an http/https URL)", path);
+        add_terminal_line(msg, LINE_FLAG_ERROR);
+        return 0;
+    }
+    if (st.st_size == 0) {
+        snprintf(msg, sizeof(msg), "Error: %s is empty", path);
+        add_terminal_line(msg, LINE_FLAG_ERROR);
+        return 0;
+    }
+
+    // Size and mtime are part of the key, so a replaced file is read again
+    char key[1100];
+    snprintf(key, sizeof(key), "file:%s:%lld:%lld", path, (long long)st.st_size, (long long)st.st_mtime);
+    if (ascii_convert_cached(key)) return 1;
+
+    int ok = 0;
+    unsigned char *raw = st.st_size <= INT_MAX
+                       ? (unsigned char *)pipeline_buffer(PIPELINE_BUF_RAW, (size_t)st.st_size) : NULL;
+    FILE *f = raw ? fopen(path, "rb") : NULL;
+    if (!raw) {
+        snprintf(msg, sizeof(msg), "Error: File too large (%lld KB, %zu MB budget)",
+                 (long long)st.st_size / 1024, pipeline_budget() >> 20);
+        add_terminal_line(msg, LINE_FLAG_ERROR);
+    } else if (!f || fread(raw, 1, (size_t)st.st_size, f) != (size_t)st.st_size) {
+        snprintf(msg, sizeof(msg), "Error: Cannot read %s", path);
+        add_terminal_line(msg, LINE_FLAG_ERROR);
+    } else {
+        snprintf(msg, sizeof(msg), "File read: %s (%lld bytes)", path, (long long)st.st_size);
+        add_terminal_line(msg, LINE_FLAG_SYSTEM);
+
+        const CachedImage *img = decode_into_cache(pending_key, raw, (int)st.st_size);
+        if (img) {
+            convert_image(img);
+            ok = 1;
+        }
+        pipeline_report(msg, sizeof(msg));
+        add_terminal_line(msg, LINE_FLAG_SYSTEM);
+    }
+    if (f) fclose(f);
+    _image_download_pending = 0;
+    reset_current_input();
+    return ok;
 }
 
 #ifdef __EMSCRIPTEN__
 int poll_image_result(void) {
     if (!_image_processing_pending) return 0;
 
-    static char* base64_buf = NULL;
-    static size_t base64_buf_max = 20 * 1024 * 1024 + 1;
-
-    if (!base64_buf) {
-        base64_buf = (char*)malloc(base64_buf_max);
-        if (!base64_buf) {
-            _image_processing_pending = 0;
-            return 1;
-        }
-    }
-    base64_buf[0] = '\0';
+    // Size first, so the text buffer is sized to this image
+    int text_size = EM_ASM_INT({
+        const res = sessionStorage.getItem("rekav_image_array");
+        return res ? lengthBytesUTF8(res) + 1 : 0;
+    });
+    if (text_size == 0) return 0;
 
+    _image_processing_pending = 0;
+    char *base64_buf = (char *)pipeline_buffer(PIPELINE_BUF_BASE64, text_size);
     EM_ASM({
-        const out_ptr = $0;
-        const maxlen = $1;
-        const res = sessionStorage.getItem("rekav_image_array");
-        if (!res) return;
-        const len = lengthBytesUTF8(res) + 1;
-        if (len > maxlen) {
-            stringToUTF8("TOO_LARGE", out_ptr, maxlen);
-            reset_current_input();
-            return;
-        }
-        stringToUTF8(res, out_ptr, maxlen);
+        if ($0) stringToUTF8(sessionStorage.getItem("rekav_image_array"), $0, $1);
         sessionStorage.removeItem("rekav_image_array");
-    }, base64_buf, base64_buf_max);
-
-    if (base64_buf[0] == '\0') return 0;
+    }, base64_buf, text_size);
 
-    if (strncmp(base64_buf, "__ERROR__:", 10) == 0) {
-        _image_processing_pending = 0;
-        add_terminal_line(base64_buf + 10, LINE_FLAG_ERROR);
+    char msg[160];
+    if (!base64_buf) {
+        snprintf(msg, sizeof(msg), "Error: Image too large (%d KB of base64, %zu MB budget)",
+                 text_size / 1024, pipeline_budget() >> 20);
+        add_terminal_line(msg, LINE_FLAG_ERROR);
         reset_current_input();
         return 1;
     }
 
-    if (strcmp(base64_buf, "TOO_LARGE") == 0) {
-        _image_processing_pending = 0;
-        add_terminal_line("Error: Image too large (base64 exceeds buffer)", LINE_FLAG_ERROR);
+    if (strncmp(base64_buf, "__ERROR__:", 10) == 0) {
+        add_terminal_line(base64_buf + 10, LINE_FLAG_ERROR);
         reset_current_input();
         return 1;
     }
 
-    static unsigned char* image_raw = NULL;
-    static size_t image_raw_max = 15 * 1024 * 1024;
-
+    size_t raw_max = (size_t)text_size / 4 * 3 + 3;
+    unsigned char *image_raw = (unsigned char *)pipeline_buffer(PIPELINE_BUF_RAW, raw_max);
     if (!image_raw) {
-        image_raw = (unsigned char*)malloc(image_raw_max);
-        if (!image_raw) {
-            _image_processing_pending = 0;
-            add_terminal_line("Error: Cannot allocate image buffer", LINE_FLAG_ERROR);
-            reset_current_input();
-            return 1;
-        }
+        add_terminal_line("Error: Cannot allocate image buffer", LINE_FLAG_ERROR);
+        reset_current_input();
+        return 1;
     }
 
-    int decoded_bytes = base64_decode(base64_buf, image_raw, image_raw_max);
-    if (decoded_bytes < 0) {
-        _image_processing_pending = 0;
+    int decoded_bytes = base64_decode(base64_buf, image_raw, raw_max);
+    if (decoded_bytes <= 0) {
         add_terminal_line("Error: Invalid base64 data", LINE_FLAG_ERROR);
         reset_current_input();
         return 1;
     }
 
-    _image_processing_pending = 0;
-
-    char msg[128];
     snprintf(msg, sizeof(msg), "Image received and decoded (%d bytes)", decoded_bytes);
     add_terminal_line(msg, LINE_FLAG_SYSTEM);
 
-    process_image_to_pixels(image_raw, decoded_bytes);
-
-    if (_image_download_pending) {
-    	add_terminal_line("call export Ascii", LINE_FLAG_SYSTEM);
-        export_ascii(image_raw, decoded_bytes, global_opts);
-        _image_download_pending = 0;
-        reset_current_input();
+    const CachedImage *img = decode_into_cache(pending_key, image_raw, decoded_bytes);
+    if (img) {
+        convert_image(img);
     }
+    pipeline_report(msg, sizeof(msg));
+    add_terminal_line(msg, LINE_FLAG_SYSTEM);
     _image_download_pending = 0;
     reset_current_input();
     return 1;
@@ -4,25 +4,11 @@
 #include <stddef.h>
 #include <stdint.h>
 #include "sdl.h"
+#include "ascii_engine.h"
+#include "image_cache.h"
 
-/*
-ASCII RAMP PRESETS
-
-RAMP 1 — Wide tonal range (smooth gradients)
-RAMP 2 — High contrast (bold shapes)
-RAMP 3 — Monospace optimized (terminal-friendly)
-RAMP 4 — Unicode enhanced (highest visual fidelity)
-RAMP 5 — Matrix
-RAMP 6 — Binary
-*/
-
-#define RAMP_1 " .'`^\",:;Il!i~+_-?][}{1)(|\\/*tfjrxnuvczXYUJCLQ0OZmwqpdbkhao*#MW&8%B@$"
-#define RAMP_2 " .:-=+*#%@"
-#define RAMP_3 "$@B%8&WM#*oahkbdpqwmZO0QLCJUYXzcvunxrjft/\\|()1{}[]?-_+~<>i!lI;:,\"^`'. "
-#define RAMP_4 " ░▒▓█"
-#define RAMP_5 " 01|/\\#"
-#define RAMP_6 " 01"
-
+#define PREVIEW_SLICE_MS     10     /* grid time per frame while a preview refines */
+#define PREVIEW_COARSE_DIV   4      /* coarse placeholder has 1/4 of the columns */
 
 /* ASCII export options (PNG generation, colors, font size) */
 typedef struct {
@@ -32,27 +18,37 @@ typedef struct {
     uint8_t bg[3];         /* background color (RGB) */
     const char *filename;  /* output filename (PNG) */
     const char *ramp;
+    int mode;              /* ASCII_MODE_* */
+    int tone;              /* TONE_* curve fitted to each image */
+    int png_level;         /* PNG deflate level 0 (store) - 9 (smallest) */
+    int png_bits;          /* indexed PNG depth 1/2/4/8, 0 = smallest exact */
+    int format;            /* ASCII_FORMAT_* of the download */
+    int view;              /* open the preview in the zoom / pan viewer */
+    int palette;           /* mode=halfblock: colors fitted by k-means, 0 = true color */
 } ExportOptions;
 
-typedef struct {
-    unsigned char *buf;
-    size_t size;
-    size_t capacity;
-} mem_writer_t;
-
 // Global State
 extern int image_processing_pending;
 extern int image_download_pending;
 
-static SDL_Texture *pixel_art_texture;
-static SDL_Rect pixel_art_dst;
 extern ExportOptions global_opts;
 void reset_export_options(ExportOptions *opts);
 
 /* Core API */
-void process_image_to_pixels(unsigned char *raw_data, int raw_size);
-void export_ascii(unsigned char *raw_data, int raw_size, ExportOptions opts);
+void process_image_to_pixels(const CachedImage *img);
+void export_ascii(const CachedImage *img, ExportOptions opts);
 int poll_image_result(void);
 
+/* Progressive preview refining in the background; ticked from the main loop */
+int ascii_preview_active(void);
+void ascii_preview_tick(void);
+void ascii_preview_cancel(void);
+
+/* Convert url straight from the image cache; 0 on a miss, url is then the one awaited from the fetch */
+int ascii_convert_cached(const char *url);
+
+/* Read, decode and convert a local file (MEMFS in the browser); 0 on failure (already reported) */
+int ascii_convert_file(const char *path);
+
 #endif /* ASCII_CONVERTER_H */
 
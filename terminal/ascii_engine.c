@@ -0,0 +1,761 @@
+#include "ascii_engine.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "braille.h"
+#include "edge_detect.h"
+#include "glyph_cache.h"
+#include "shape_match.h"
+#include "workers.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const char *engine_font_path = "font.ttf";
+
+void ascii_engine_set_font(const char *path) {
+    if (path) engine_font_path = path;
+}
+
+const char *ascii_ramp_preset(int n) {
+    switch (n) {
+        case 2: return RAMP_2;
+        case 3: return RAMP_3;
+        case 4: return RAMP_4;
+        case 5: return RAMP_5;
+        case 6: return RAMP_6;
+        default: return RAMP_1;
+    }
+}
+
+void parse_color(const char *name, uint8_t *r, uint8_t *g, uint8_t *b) {
+    if (strcmp(name, "black") == 0) { *r=0; *g=0; *b=0; }
+    else if (strcmp(name, "white") == 0) { *r=255; *g=255; *b=255; }
+    else if (strcmp(name, "red") == 0) { *r=255; *g=0; *b=0; }
+    else if (strcmp(name, "green") == 0) { *r=0; *g=255; *b=0; }
+    else if (strcmp(name, "blue") == 0) { *r=0; *g=0; *b=255; }
+    else if (strcmp(name, "pink") == 0) { *r=255; *g=192; *b=203; }
+    else if (strcmp(name, "purple") == 0) { *r=128; *g=0; *b=128; }
+    else { *r=255; *g=255; *b=255; } // default white
+}
+
+int ascii_grid_rows(int width, int height, int cols, float char_aspect) {
+    if (width <= 0) return 1;
+    int rows = (int)((float)(height * cols) / (float)width / char_aspect);
+    return rows < 1 ? 1 : rows;
+}
+
+int ascii_source_width(int cols, int mode) {
+    // Shape matching averages SHAPE_W columns per cell; the ramp samples one pixel, two leave room to average
+    if (mode == ASCII_MODE_SHAPE) return cols * SHAPE_W;
+    if (mode == ASCII_MODE_BRAILLE) return cols * 4;     // two dots per cell
+    return cols * 2;
+}
+
+static const char *mode_names[] = { "ramp", "shape", "braille", "halfblock", "edges", "pixel" };
+
+int ascii_mode_from_name(const char *name) {
+    for (int m = 0; m < (int)(sizeof(mode_names) / sizeof(mode_names[0])); m++) {
+        if (strcmp(name, mode_names[m]) == 0) return m;
+    }
+    return ASCII_MODE_RAMP;
+}
+
+const char *ascii_mode_name(int mode) {
+    return (mode >= 0 && mode < (int)(sizeof(mode_names) / sizeof(mode_names[0]))) ? mode_names[mode] : "ramp";
+}
+
+/* Bytes in the UTF-8 sequence at p, 0 if malformed */
+static int utf8_seq_len(const unsigned char *p) {
+    int n = p[0] < 0x80 ? 1 : (p[0] & 0xE0) == 0xC0 ? 2 : (p[0] & 0xF0) == 0xE0 ? 3 : (p[0] & 0xF8) == 0xF0 ? 4 : 0;
+    for (int i = 1; i < n; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    }
+    return n;
+}
+
+/* Linear LUT over the first levels glyphs */
+static void ramp_levels(AsciiRamp *ramp, int levels) {
+    ramp->levels = levels;
+    for (int i = 0; i < levels; i++) {
+        ramp->level[i] = levels > 1 ? i * 255.0f / (levels - 1) : 0.0f;
+    }
+    for (int v = 0; v < 256; v++) {
+        ramp->lut[v] = (uint8_t)(v * levels / 256);
+        ramp->tone[v] = (uint8_t)v;
+    }
+}
+
+int ascii_ramp_parse(AsciiRamp *ramp, const char *utf8) {
+    if (!ramp) return 0;
+    memset(ramp, 0, sizeof(*ramp));
+    if (!utf8) return 0;
+
+    const unsigned char *p = (const unsigned char *)utf8;
+    while (*p && ramp->count < ASCII_RAMP_MAX) {
+        int n = utf8_seq_len(p);
+        if (n == 0) {   // stray byte: skip it rather than emit a broken sequence
+            p++;
+            continue;
+        }
+        memcpy(ramp->glyph[ramp->count], p, n);
+        ramp->len[ramp->count++] = (uint8_t)n;
+        if (n > ramp->max_len) ramp->max_len = n;
+        p += n;
+    }
+    if (ramp->count == 0) return 0;
+    ramp_levels(ramp, ramp->count);
+    return ramp->count;
+}
+
+int ascii_ramp_for_mode(AsciiRamp *ramp, const char *utf8, int mode) {
+    if (ascii_mode_color(mode)) return ascii_ramp_parse(ramp, ASCII_HALFBLOCK_GLYPH);
+    if (mode == ASCII_MODE_EDGES) {
+        if (!ascii_ramp_parse(ramp, utf8)) return 0;
+        if (ramp->count > ASCII_RAMP_MAX - EDGE_DIRS) {
+            ramp->count = ASCII_RAMP_MAX - EDGE_DIRS;
+            ramp_levels(ramp, ramp->count);
+        }
+        for (int i = 0; i < EDGE_DIRS; i++) {
+            memset(ramp->glyph[ramp->count], 0, sizeof(ramp->glyph[0]));
+            ramp->glyph[ramp->count][0] = EDGE_GLYPHS[i];
+            ramp->len[ramp->count++] = 1;
+        }
+        return ramp->count;
+    }
+    if (mode != ASCII_MODE_BRAILLE) return ascii_ramp_parse(ramp, utf8);
+    char dots[BRAILLE_RAMP_BYTES];
+    braille_ramp_text(dots);
+    return ascii_ramp_parse(ramp, dots);
+}
+
+void ascii_ramp_tone(AsciiRamp *ramp, const unsigned char *pixels, int width, int height,
+                     int rows, int tone) {
+    if (!ramp || ramp->count == 0 || tone == TONE_OFF) return;
+
+    uint32_t hist[256];
+    tone_histogram(pixels, width, height, rows, hist);
+    tone_curve(hist, tone, ramp->tone);
+
+    // Glyph of the mapped luma, and for dithering the source luma each glyph now stands for
+    int v = 0;
+    for (int i = 0; i < ramp->levels; i++) {
+        float target = ramp->levels > 1 ? i * 255.0f / (ramp->levels - 1) : 0.0f;
+        while (v < 255 && ramp->tone[v] < target) v++;
+        ramp->level[i] = (float)v;
+    }
+    for (v = 0; v < 256; v++) ramp->lut[v] = (uint8_t)(ramp->tone[v] * ramp->levels / 256);
+}
+
+size_t ascii_row_text(const AsciiRamp *ramp, const uint8_t *cells, int cols, char *out) {
+    char *p = out;
+    for (int col = 0; col < cols; col++) {
+        int g = cells[col];
+        memcpy(p, ramp->glyph[g], ramp->len[g]);
+        p += ramp->len[g];
+    }
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+/* Ramp index of luma plus the error carried to column x, diffusing what is left (Floyd-Steinberg) */
+static inline uint8_t dither_cell(const AsciiRamp *ramp, float gray, float *error, float *next_row, int x) {
+    gray += error[x+1];
+    if (gray < 0) gray = 0;
+    if (gray > 255) gray = 255;
+
+    int idx = ramp->lut[(int)gray];
+
+    float quant_error = gray - ramp->level[idx];
+    error[x+1]      += quant_error * 7.0f/16.0f;
+    next_row[x]      += quant_error * 3.0f/16.0f;
+    next_row[x+1]    += quant_error * 5.0f/16.0f;
+    next_row[x+2]    += quant_error * 1.0f/16.0f;
+    return (uint8_t)idx;
+}
+
+/* Brightness -> ramp index through the LUT, with Floyd-Steinberg error diffusion */
+static void ramp_rows(AsciiGridJob *job, int end) {
+    const AsciiRamp *ramp = job->ramp;
+    int cols = job->cols;
+    float *error = job->error, *next_row = job->next_error;
+
+    for (int y = job->next_row; y < end; y++) {
+        uint8_t *p = job->cells + (size_t)y * cols;
+        int sy = (y * job->height) / job->rows;
+
+        for (int x = 0; x < cols; x++) {
+            int sx = (x * job->width) / cols;
+            const unsigned char *px = job->pixels + ((size_t)sy * job->width + sx) * 4;
+
+            float r = px[0], g = px[1], b = px[2];
+            *p++ = dither_cell(ramp, 0.299f*r + 0.587f*g + 0.114f*b, error, next_row, x);
+        }
+        memcpy(error, next_row, (cols+4)*sizeof(float));
+        memset(next_row, 0, (cols+4)*sizeof(float));
+    }
+}
+
+/* Edge glyphs (after the ramp levels) where the gradient is strong, the dithered ramp elsewhere */
+static void edge_rows(AsciiGridJob *job, int end) {
+    const AsciiRamp *ramp = job->ramp;
+    int cols = job->cols;
+    float *error = job->error, *next_row = job->next_error;
+    int8_t *dir = (int8_t *)job->scratch + edge_scratch_bytes(cols);
+    uint8_t *luma = (uint8_t *)(dir + cols);
+
+    for (int y = job->next_row; y < end; y++) {
+        uint8_t *p = job->cells + (size_t)y * cols;
+        edge_row(job->pixels, job->width, job->height, cols, job->rows, y, job->scratch, dir, luma);
+
+        for (int x = 0; x < cols; x++) {
+            // Edge cells neither take nor pass on dithering error
+            p[x] = dir[x] != EDGE_NONE ? (uint8_t)(ramp->levels + dir[x])
+                                       : dither_cell(ramp, luma[x], error, next_row, x);
+        }
+        memcpy(error, next_row, (cols+4)*sizeof(float));
+        memset(next_row, 0, (cols+4)*sizeof(float));
+    }
+}
+
+/* Box-filtered color of each half cell, tone curve applied per channel */
+static void halfblock_rows(AsciiGridJob *job, int end) {
+    int cols = job->cols, width = job->width, height = job->height;
+    int texel_rows = job->rows * 2;
+    const uint8_t *tone = job->ramp->tone;
+
+    for (int t = job->next_row * 2; t < end * 2; t++) {
+        int y0 = (int)((long long)t * height / texel_rows);
+        int y1 = (int)((long long)(t + 1) * height / texel_rows);
+        if (y1 <= y0) y1 = y0 + 1;
+        uint8_t *out = job->cells + (size_t)t * cols * 4;
+
+        for (int x = 0; x < cols; x++, out += 4) {
+            int x0 = (int)((long long)x * width / cols);
+            int x1 = (int)((long long)(x + 1) * width / cols);
+            if (x1 <= x0) x1 = x0 + 1;
+
+            uint32_t r = 0, g = 0, b = 0;
+            for (int y = y0; y < y1; y++) {
+                const unsigned char *px = job->pixels + ((size_t)y * width + x0) * 4;
+                for (int i = x0; i < x1; i++, px += 4) {
+                    r += px[0];
+                    g += px[1];
+                    b += px[2];
+                }
+            }
+            uint32_t n = (uint32_t)(y1 - y0) * (x1 - x0);
+            out[0] = tone[(r + n / 2) / n];
+            out[1] = tone[(g + n / 2) / n];
+            out[2] = tone[(b + n / 2) / n];
+            out[3] = 255;
+        }
+    }
+}
+
+/* Shape templates of the last ramp used; rebuilt only when the ramp changes */
+static ShapeSet shape_cache;
+static AsciiRamp shape_cache_ramp;
+
+static int same_glyphs(const AsciiRamp *a, const AsciiRamp *b) {
+    return a->count == b->count && memcmp(a->glyph, b->glyph, sizeof(a->glyph[0]) * a->count) == 0;
+}
+
+static const ShapeSet *shape_templates(const AsciiRamp *ramp) {
+    if (shape_cache.count && same_glyphs(&shape_cache_ramp, ramp)) return &shape_cache;
+    shape_set_free(&shape_cache);
+
+    const char *strs[ASCII_RAMP_MAX];
+    for (int i = 0; i < ramp->count; i++) strs[i] = ramp->glyph[i];
+
+    if (TTF_WasInit() == 0) TTF_Init();
+    TTF_Font *font = TTF_OpenFont(engine_font_path, SHAPE_FONT_SIZE);
+    if (!font) return NULL;
+    int ok = shape_set_build(&shape_cache, font, strs, ramp->count);
+    TTF_CloseFont(font);
+    if (!ok) return NULL;
+
+    shape_cache_ramp = *ramp;
+    return &shape_cache;
+}
+
+int ascii_shape_glyphs(const AsciiRamp *ramp) {
+    const ShapeSet *set = shape_templates(ramp);
+    return set ? set->count : 0;
+}
+
+int ascii_grid_begin(AsciiGridJob *job, const unsigned char *pixels, int width, int height,
+                     int cols, int rows, const AsciiRamp *ramp, int mode, uint8_t *cells) {
+    memset(job, 0, sizeof(*job));
+    if (!ramp || ramp->count == 0 || cols <= 0 || rows <= 0) return 0;
+
+    job->pixels = pixels;
+    job->width = width;
+    job->height = height;
+    job->cols = cols;
+    job->rows = rows;
+    job->ramp = ramp;
+    job->mode = mode;
+    job->cells = cells;
+
+    if (mode == ASCII_MODE_SHAPE) return shape_templates(ramp) != NULL;
+    if (mode == ASCII_MODE_BRAILLE) {
+        job->scratch = malloc(braille_scratch_bytes(cols));
+        return job->scratch != NULL;
+    }
+    if (mode == ASCII_MODE_HALFBLOCK) return 1;
+    if (mode == ASCII_MODE_EDGES) {
+        // Sample rows, then the direction and luma of each cell
+        job->scratch = malloc(edge_scratch_bytes(cols) + 2 * (size_t)cols);
+        if (!job->scratch) return 0;
+    }
+
+    job->error = (float *)calloc(2 * ((size_t)cols + 4), sizeof(float));
+    job->next_error = job->error + cols + 4;
+    return job->error != NULL;
+}
+
+int ascii_grid_step(AsciiGridJob *job, int max_rows) {
+    int end = job->next_row + max_rows;
+    if (max_rows <= 0 || end > job->rows) end = job->rows;
+
+    if (job->mode == ASCII_MODE_SHAPE) {
+        // Looked up per step: the cache may have moved on to another ramp in between
+        const ShapeSet *set = shape_templates(job->ramp);
+        if (!set || !shape_match_rows(set, job->pixels, job->width, job->height, job->cols, job->rows,
+                                      job->ramp->tone, job->cells, job->next_row, end)) {
+            return -1;
+        }
+    } else if (job->mode == ASCII_MODE_BRAILLE) {
+        braille_rows(job->pixels, job->width, job->height, job->cols, job->rows,
+                     job->ramp->tone, job->scratch, job->cells, job->next_row, end);
+    } else if (job->mode == ASCII_MODE_HALFBLOCK) {
+        halfblock_rows(job, end);
+    } else if (job->mode == ASCII_MODE_EDGES) {
+        edge_rows(job, end);
+    } else {
+        ramp_rows(job, end);
+    }
+    job->next_row = end;
+    return job->rows - end;
+}
+
+void ascii_grid_end(AsciiGridJob *job) {
+    free(job->error);
+    free(job->scratch);
+    memset(job, 0, sizeof(*job));
+}
+
+int ascii_grid_fill(const unsigned char *pixels, int width, int height,
+                    int cols, int rows, const AsciiRamp *ramp, int mode, uint8_t *cells) {
+    AsciiGridJob job;
+    int ok = ascii_grid_begin(&job, pixels, width, height, cols, rows, ramp, mode, cells) &&
+             ascii_grid_step(&job, 0) == 0;
+    ascii_grid_end(&job);
+    return ok;
+}
+
+static inline uint8_t blend_channel(uint8_t bg, uint8_t fg, int a) {
+    return (uint8_t)((bg * (255 - a) + fg * a + 127) / 255);
+}
+
+/*
+ Glyph coverage mapped to palette indices. Every color in the image is
+ bg/fg blended by some coverage value, so the palette is exact when the
+ distinct coverages fit in 2^bits entries, and evenly quantized otherwise.
+*/
+static uint8_t *build_index_tiles(const GlyphSet *glyphs, const uint8_t fg[3], const uint8_t bg[3],
+                                  int *bits, uint8_t *palette, int *palette_size) {
+    size_t cell_px = (size_t)glyphs->cell_w * glyphs->cell_h;
+    size_t total = (size_t)glyphs->count * cell_px;
+
+    int used[256] = {0};
+    used[0] = 1;    // keep bg in the palette even if every glyph is inked
+    for (size_t i = 0; i < total; i++) used[glyphs->coverage[i]] = 1;
+
+    int distinct = 0;
+    for (int a = 0; a < 256; a++) distinct += used[a];
+
+    if (*bits == 0) {
+        *bits = distinct <= 2 ? 1 : distinct <= 4 ? 2 : distinct <= 16 ? 4 : 8;
+    }
+    int levels = 1 << *bits;
+
+    uint8_t map[256];
+    int n = 0;
+    if (distinct <= levels) {
+        for (int a = 0; a < 256; a++) {
+            if (!used[a]) continue;
+            map[a] = (uint8_t)n;
+            for (int c = 0; c < 3; c++) palette[n * 3 + c] = blend_channel(bg[c], fg[c], a);
+            n++;
+        }
+    } else {
+        for (int l = 0; l < levels; l++) {
+            int a = l * 255 / (levels - 1);
+            for (int c = 0; c < 3; c++) palette[l * 3 + c] = blend_channel(bg[c], fg[c], a);
+        }
+        for (int a = 0; a < 256; a++) map[a] = (uint8_t)((a * (levels - 1) + 127) / 255);
+        n = levels;
+    }
+    *palette_size = n;
+
+    uint8_t *tiles = (uint8_t *)malloc(total);
+    if (!tiles) return NULL;
+
+    for (size_t i = 0; i < total; i++) tiles[i] = map[glyphs->coverage[i]];
+    return tiles;
+}
+
+int ascii_tileset_build(AsciiTileset *ts, TTF_Font *font, const AsciiRamp *ramp,
+                        const uint8_t fg[3], const uint8_t bg[3], int bits) {
+    if (!ts || !font || !ramp || ramp->count == 0) return 0;
+    memset(ts, 0, sizeof(*ts));
+
+    // Rasterize every ramp glyph once at the export font size; tile i is glyph i
+    const char *strs[ASCII_RAMP_MAX];
+    for (int i = 0; i < ramp->count; i++) strs[i] = ramp->glyph[i];
+
+    GlyphSet glyphs;
+    if (!glyph_set_build(&glyphs, font, strs, ramp->count)) return 0;
+
+    ts->cell_w = glyphs.cell_w;
+    ts->cell_h = glyphs.cell_h;
+    ts->bits = bits;
+    ts->tiles = build_index_tiles(&glyphs, fg, bg, &ts->bits, ts->palette, &ts->palette_size);
+    glyph_set_free(&glyphs);
+    return ts->tiles != NULL;
+}
+
+void ascii_tileset_free(AsciiTileset *ts) {
+    if (!ts) return;
+    free(ts->tiles);
+    memset(ts, 0, sizeof(*ts));
+}
+
+size_t ascii_write_png(const AsciiTileset *ts, const uint8_t *cells, int cols, int rows,
+                       int level, png_sink_func sink, void *ctx) {
+    int img_width = cols * ts->cell_w;
+    int img_height = rows * ts->cell_h;
+    if (img_width <= 0 || img_height <= 0) return 0;
+
+    // Only one strip of cell rows is ever composed in memory
+    int strip_rows = rows < ASCII_STRIP_ROWS ? rows : ASCII_STRIP_ROWS;
+    size_t row_bytes = (size_t)img_width;
+    uint8_t *strip = (uint8_t *)malloc(row_bytes * ts->cell_h * strip_rows);
+    if (!strip) return 0;
+
+    PngWriter *pw = png_writer_begin_indexed(img_width, img_height, ts->bits, ts->palette, ts->palette_size,
+                                             level, sink, ctx);
+    GlyphStamp job = {
+        .cols = cols,
+        .cell_w = ts->cell_w,
+        .cell_h = ts->cell_h,
+        .bpp = 1,
+        .tiles = ts->tiles,
+        .pixels = strip,
+        .pitch = (int)row_bytes,
+    };
+
+    for (int row = 0; pw && row < rows; row += strip_rows) {
+        int n = rows - row < strip_rows ? rows - row : strip_rows;
+        job.cells = cells + (size_t)row * cols;
+        run_bands(glyph_stamp_rows, &job, n);
+
+        int ok = 1;
+        for (int y = 0; y < n * ts->cell_h && ok; y++) {
+            ok = png_writer_row(pw, strip + (size_t)y * row_bytes);
+        }
+        if (!ok) break;
+    }
+
+    free(strip);
+    return png_writer_end(pw);
+}
+
+/* acc[i] += row[i] for n bytes, 16 at a time widened to 32-bit lanes */
+static void accumulate_row(uint32_t *acc, const unsigned char *row, int n) {
+    int i = 0;
+#if defined(__wasm_simd128__)
+    for (; i + 16 <= n; i += 16) {
+        v128_t v = wasm_v128_load(row + i);
+        v128_t lo = wasm_u16x8_extend_low_u8x16(v), hi = wasm_u16x8_extend_high_u8x16(v);
+        wasm_v128_store(acc + i, wasm_i32x4_add(wasm_v128_load(acc + i), wasm_u32x4_extend_low_u16x8(lo)));
+        wasm_v128_store(acc + i + 4, wasm_i32x4_add(wasm_v128_load(acc + i + 4), wasm_u32x4_extend_high_u16x8(lo)));
+        wasm_v128_store(acc + i + 8, wasm_i32x4_add(wasm_v128_load(acc + i + 8), wasm_u32x4_extend_low_u16x8(hi)));
+        wasm_v128_store(acc + i + 12, wasm_i32x4_add(wasm_v128_load(acc + i + 12), wasm_u32x4_extend_high_u16x8(hi)));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+        __m128i *a = (__m128i *)(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi32(_mm_loadu_si128(a), _mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi, zero)));
+    }
+#endif
+    for (; i < n; i++) acc[i] += row[i];
+}
+
+int ascii_pixel_blocks(const unsigned char *rgba, int width, int height, int bw, int bh,
+                       const uint8_t *tone, uint8_t *out) {
+    uint32_t *acc = (uint32_t *)malloc((size_t)width * 4 * sizeof(uint32_t));
+    if (!acc) return 0;
+
+    for (int by = 0; by < bh; by++) {
+        int y0 = (int)((long long)by * height / bh);
+        int y1 = (int)((long long)(by + 1) * height / bh);
+        if (y1 <= y0) y1 = y0 + 1;
+
+        // Column sums of the block row first, so every source row is read once
+        memset(acc, 0, (size_t)width * 4 * sizeof(uint32_t));
+        for (int y = y0; y < y1; y++) accumulate_row(acc, rgba + (size_t)y * width * 4, width * 4);
+
+        uint8_t *dst = out + (size_t)by * bw * 4;
+        for (int bx = 0; bx < bw; bx++, dst += 4) {
+            int x0 = (int)((long long)bx * width / bw);
+            int x1 = (int)((long long)(bx + 1) * width / bw);
+            if (x1 <= x0) x1 = x0 + 1;
+
+            uint32_t sum[3] = { 0, 0, 0 };
+            for (int x = x0; x < x1; x++) {
+                sum[0] += acc[x * 4];
+                sum[1] += acc[x * 4 + 1];
+                sum[2] += acc[x * 4 + 2];
+            }
+            uint32_t n = (uint32_t)(y1 - y0) * (x1 - x0);
+            for (int c = 0; c < 3; c++) {
+                uint8_t v = (uint8_t)((sum[c] + n / 2) / n);
+                dst[c] = tone ? tone[v] : v;
+            }
+            dst[3] = 255;
+        }
+    }
+
+    free(acc);
+    return 1;
+}
+
+size_t ascii_write_halfblock_png(const uint8_t *texels, int cols, int rows, int cell_w, int cell_h,
+                                 int level, png_sink_func sink, void *ctx) {
+    int img_width = cols * cell_w;
+    int img_height = rows * cell_h;
+    if (img_width <= 0 || img_height <= 0) return 0;
+
+    uint8_t *line = (uint8_t *)malloc((size_t)img_width * 3);
+    if (!line) return 0;
+
+    PngWriter *pw = png_writer_begin(img_width, img_height, 3, level, sink, ctx);
+    int top = cell_h / 2;
+    int ok = pw != NULL;
+    for (int t = 0; ok && t < rows * 2; t++) {
+        // One texel row widened to cell_w runs, repeated over its half of the cell
+        const uint8_t *src = texels + (size_t)t * cols * 4;
+        uint8_t *p = line;
+        for (int x = 0; x < cols; x++, src += 4) {
+            for (int i = 0; i < cell_w; i++, p += 3) {
+                p[0] = src[0];
+                p[1] = src[1];
+                p[2] = src[2];
+            }
+        }
+        int n = (t & 1) ? cell_h - top : top;
+        for (int y = 0; ok && y < n; y++) ok = png_writer_row(pw, line);
+    }
+
+    free(line);
+    return png_writer_end(pw);
+}
+
+size_t ascii_write_halfblock_indexed_png(const uint8_t *index, int cols, int rows, int cell_w, int cell_h,
+                                         const Palette *pal, int level, png_sink_func sink, void *ctx) {
+    int img_width = cols * cell_w;
+    int img_height = rows * cell_h;
+    if (img_width <= 0 || img_height <= 0 || pal->count == 0) return 0;
+
+    uint8_t *line = (uint8_t *)malloc((size_t)img_width);
+    if (!line) return 0;
+
+    PngWriter *pw = png_writer_begin_indexed(img_width, img_height, palette_bits(pal), pal->rgb, pal->count,
+                                             level, sink, ctx);
+    int top = cell_h / 2;
+    int ok = pw != NULL;
+    for (int t = 0; ok && t < rows * 2; t++) {
+        const uint8_t *src = index + (size_t)t * cols;
+        for (int x = 0; x < cols; x++) memset(line + x * cell_w, src[x], cell_w);
+        int n = (t & 1) ? cell_h - top : top;
+        for (int y = 0; ok && y < n; y++) ok = png_writer_row(pw, line);
+    }
+
+    free(line);
+    return png_writer_end(pw);
+}
+
+size_t ascii_halfblock_row_ansi(const uint8_t *texels, int cols, int row, char *out) {
+    const uint8_t *top = texels + (size_t)row * 2 * cols * 4;
+    const uint8_t *bottom = top + (size_t)cols * 4;
+    char *p = out;
+    for (int x = 0; x < cols; x++, top += 4, bottom += 4) {
+        // Colors only where they differ from the cell before
+        if (x == 0 || memcmp(top, top - 4, 3) != 0 || memcmp(bottom, bottom - 4, 3) != 0) {
+            p += sprintf(p, "\x1b[38;2;%d;%d;%d;48;2;%d;%d;%dm",
+                         top[0], top[1], top[2], bottom[0], bottom[1], bottom[2]);
+        }
+        memcpy(p, ASCII_HALFBLOCK_GLYPH, sizeof(ASCII_HALFBLOCK_GLYPH) - 1);
+        p += sizeof(ASCII_HALFBLOCK_GLYPH) - 1;
+    }
+    memcpy(p, "\x1b[0m", 5);
+    return (size_t)(p + 4 - out);
+}
+
+static const char *format_names[] = { "png", "txt", "ansi", "html" };
+static const char *format_exts[] = { ".png", ".txt", ".ans", ".html" };
+
+int ascii_format_from_name(const char *name) {
+    for (int f = 0; f < (int)(sizeof(format_names) / sizeof(format_names[0])); f++) {
+        if (strcmp(name, format_names[f]) == 0) return f;
+    }
+    return ASCII_FORMAT_PNG;
+}
+
+const char *ascii_format_name(int format) {
+    return (format >= 0 && format <= ASCII_FORMAT_HTML) ? format_names[format] : "png";
+}
+
+const char *ascii_format_ext(int format) {
+    return (format >= 0 && format <= ASCII_FORMAT_HTML) ? format_exts[format] : ".png";
+}
+
+/* Text gathered into one chunk and handed to the sink whenever it fills */
+typedef struct {
+    char buf[ASCII_TEXT_CHUNK];
+    size_t len;
+    size_t total;
+    int failed;
+    png_sink_func sink;
+    void *ctx;
+} TextStream;
+
+static void text_flush(TextStream *t) {
+    if (t->len > 0 && !t->failed) {
+        if (t->sink(t->ctx, t->buf, t->len)) t->total += t->len;
+        else t->failed = 1;
+    }
+    t->len = 0;
+}
+
+static void text_put(TextStream *t, const char *data, size_t n) {
+    if (t->len + n > sizeof(t->buf)) text_flush(t);
+    if (n > sizeof(t->buf)) {
+        // Larger than a chunk on its own: straight through
+        if (!t->failed && t->sink(t->ctx, data, n)) t->total += n;
+        else t->failed = 1;
+        return;
+    }
+    memcpy(t->buf + t->len, data, n);
+    t->len += n;
+}
+
+static void text_puts(TextStream *t, const char *s) {
+    text_put(t, s, strlen(s));
+}
+
+/* Glyph with the HTML specials escaped */
+static void html_glyph(TextStream *t, const char *glyph, size_t len) {
+    if (len == 1) {
+        switch (glyph[0]) {
+            case '&': text_puts(t, "&amp;"); return;
+            case '<': text_puts(t, "&lt;"); return;
+            case '>': text_puts(t, "&gt;"); return;
+            case '"': text_puts(t, "&quot;"); return;
+        }
+    }
+    text_put(t, glyph, len);
+}
+
+/* Half-block row as spans, one per run of cells with the same two colors */
+static void html_halfblock_row(TextStream *t, const uint8_t *texels, int cols, int row) {
+    const uint8_t *top = texels + (size_t)row * 2 * cols * 4;
+    const uint8_t *bottom = top + (size_t)cols * 4;
+    char span[80];
+    for (int x = 0; x < cols;) {
+        int run = 1;
+        while (x + run < cols && memcmp(top + (x + run) * 4, top + x * 4, 3) == 0 &&
+               memcmp(bottom + (x + run) * 4, bottom + x * 4, 3) == 0) {
+            run++;
+        }
+        snprintf(span, sizeof(span), "<span style=\"color:#%02x%02x%02x;background:#%02x%02x%02x\">",
+                 top[x * 4], top[x * 4 + 1], top[x * 4 + 2], bottom[x * 4], bottom[x * 4 + 1], bottom[x * 4 + 2]);
+        text_puts(t, span);
+        for (int i = 0; i < run; i++) text_puts(t, ASCII_HALFBLOCK_GLYPH);
+        text_puts(t, "</span>");
+        x += run;
+    }
+}
+
+size_t ascii_write_text(const AsciiRamp *ramp, int mode, const uint8_t *cells, int cols, int rows, int format,
+                        const uint8_t fg[3], const uint8_t bg[3], png_sink_func sink, void *ctx) {
+    int halfblock = mode == ASCII_MODE_HALFBLOCK;
+    if (halfblock && format == ASCII_FORMAT_TXT) format = ASCII_FORMAT_ANSI;     // plain "▀" rows show nothing
+
+    TextStream *t = (TextStream *)malloc(sizeof(TextStream));
+    char *row_buf = (char *)malloc(halfblock ? ascii_halfblock_ansi_bytes(cols) : ascii_row_bytes(ramp, cols));
+    if (!t || !row_buf) {
+        free(t);
+        free(row_buf);
+        return 0;
+    }
+    t->len = 0;
+    t->total = 0;
+    t->failed = 0;
+    t->sink = sink;
+    t->ctx = ctx;
+
+    char sgr[64];
+    snprintf(sgr, sizeof(sgr), "\x1b[38;2;%d;%d;%d;48;2;%d;%d;%dm", fg[0], fg[1], fg[2], bg[0], bg[1], bg[2]);
+    if (format == ASCII_FORMAT_HTML) {
+        char head[320];
+        snprintf(head, sizeof(head),
+                 "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>ASCII art</title></head>\n"
+                 "<body style=\"margin:0;background:#%02x%02x%02x\">"
+                 "<pre style=\"margin:0;font-family:monospace;line-height:1;color:#%02x%02x%02x\">\n",
+                 bg[0], bg[1], bg[2], fg[0], fg[1], fg[2]);
+        text_puts(t, head);
+    }
+
+    for (int row = 0; row < rows && !t->failed; row++) {
+        if (halfblock && format == ASCII_FORMAT_ANSI) {
+            text_put(t, row_buf, ascii_halfblock_row_ansi(cells, cols, row, row_buf));
+        } else if (halfblock) {
+            html_halfblock_row(t, cells, cols, row);
+        } else if (format == ASCII_FORMAT_HTML) {
+            const uint8_t *p = cells + (size_t)row * cols;
+            for (int x = 0; x < cols; x++) html_glyph(t, ramp->glyph[p[x]], ramp->len[p[x]]);
+        } else {
+            // Reset at the end of every row so the background never runs past it
+            if (format == ASCII_FORMAT_ANSI) text_puts(t, sgr);
+            text_put(t, row_buf, ascii_row_text(ramp, cells + (size_t)row * cols, cols, row_buf));
+            if (format == ASCII_FORMAT_ANSI) text_puts(t, "\x1b[0m");
+        }
+        text_put(t, "\n", 1);
+    }
+
+    if (format == ASCII_FORMAT_HTML) text_puts(t, "</pre></body></html>\n");
+    text_flush(t);
+
+    size_t total = t->failed ? 0 : t->total;
+    free(row_buf);
+    free(t);
+    return total;
+}
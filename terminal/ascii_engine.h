@@ -0,0 +1,233 @@
+#ifndef ASCII_ENGINE_H
+#define ASCII_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sdl.h"
+#include "png_writer.h"
+#include "palette.h"
+#include "tone_map.h"
+
+/*
+ASCII conversion engine
+
+Image -> character grid -> indexed PNG, with no terminal dependency: shared
+by the WASM terminal (ascii_converter.c) and the native batch tool
+(ascii_batch.c). Grids are rows * cols glyph indices into a parsed ramp;
+UTF-8 text is only produced when a row is printed or saved.
+*/
+
+/*
+ASCII RAMP PRESETS
+
+RAMP 1 — Wide tonal range (smooth gradients)
+RAMP 2 — High contrast (bold shapes)
+RAMP 3 — Monospace optimized (terminal-friendly)
+RAMP 4 — Unicode enhanced (highest visual fidelity)
+RAMP 5 — Matrix
+RAMP 6 — Binary
+*/
+
+#define RAMP_1 " .'`^\",:;Il!i~+_-?][}{1)(|\\/*tfjrxnuvczXYUJCLQ0OZmwqpdbkhao*#MW&8%B@$"
+#define RAMP_2 " .:-=+*#%@"
+#define RAMP_3 "$@B%8&WM#*oahkbdpqwmZO0QLCJUYXzcvunxrjft/\\|()1{}[]?-_+~<>i!lI;:,\"^`'. "
+#define RAMP_4 " ░▒▓█"
+#define RAMP_5 " 01|/\\#"
+#define RAMP_6 " 01"
+
+/* Glyph selection modes */
+#define ASCII_MODE_RAMP   0    /* brightness -> ramp index, dithered */
+#define ASCII_MODE_SHAPE  1    /* glyph whose bitmap best matches the cell */
+#define ASCII_MODE_BRAILLE 2   /* 2x4 dithered dots per cell, U+2800 patterns */
+#define ASCII_MODE_HALFBLOCK 3 /* "▀", fg = top pixel, bg = bottom pixel (true color) */
+#define ASCII_MODE_EDGES  4    /* orientation glyphs on strong gradients, ramp elsewhere */
+#define ASCII_MODE_PIXEL  5    /* preview as square color blocks, no glyphs (exports as halfblock) */
+
+/* Half-block grids hold two RGBA texels per cell: texel row 2 * row is the top half */
+#define ASCII_HALFBLOCK_GLYPH "▀"
+
+/* 1 if mode shows the image's colors, so it must be decoded in color */
+static inline int ascii_mode_color(int mode) {
+    return mode == ASCII_MODE_HALFBLOCK || mode == ASCII_MODE_PIXEL;
+}
+
+/* Mode a grid export uses: pixel previews export as half blocks */
+static inline int ascii_export_mode(int mode) {
+    return mode == ASCII_MODE_PIXEL ? ASCII_MODE_HALFBLOCK : mode;
+}
+
+/* Grid bytes per cell in mode */
+static inline size_t ascii_cell_bytes(int mode) {
+    return mode == ASCII_MODE_HALFBLOCK ? 8 : 1;
+}
+
+/* Longest ramp; grid cells are 8-bit glyph indices */
+#define ASCII_RAMP_MAX 256
+
+/* Ramp split into UTF-8 glyphs once, with its luma -> glyph lookup */
+typedef struct {
+    int count;
+    int levels;                         /* leading glyphs the LUT spans; mode glyphs may follow */
+    int max_len;                        /* longest glyph in bytes */
+    char glyph[ASCII_RAMP_MAX][5];      /* NUL-terminated UTF-8 */
+    uint8_t len[ASCII_RAMP_MAX];
+    float level[ASCII_RAMP_MAX];        /* luma each glyph stands for */
+    uint8_t lut[256];                   /* luma -> glyph index */
+    uint8_t tone[256];                  /* luma -> tone-mapped luma (mode=shape) */
+} AsciiRamp;
+
+/* Cell height / width used to size grids */
+#define ASCII_PREVIEW_ASPECT  1.6f
+#define ASCII_EXPORT_ASPECT   2.2f
+
+/* Cell rows composed per PNG strip */
+#define ASCII_STRIP_ROWS 16
+
+/* RAMP_n for n in 1..6, RAMP_1 otherwise */
+const char *ascii_ramp_preset(int n);
+
+/* ASCII_MODE_* for ramp/shape/braille/halfblock/edges/pixel, ASCII_MODE_RAMP if unknown */
+int ascii_mode_from_name(const char *name);
+const char *ascii_mode_name(int mode);
+
+/* Split a UTF-8 ramp (darkest first) and build its LUT; returns the glyph count, 0 if unusable */
+int ascii_ramp_parse(AsciiRamp *ramp, const char *utf8);
+
+/*
+ Ramp the grid of mode indexes: the 256 dot patterns for braille, the half
+ block alone for halfblock, utf8 followed by the EDGE_GLYPHS for edges,
+ utf8 otherwise.
+*/
+int ascii_ramp_for_mode(AsciiRamp *ramp, const char *utf8, int mode);
+
+/*
+ Adapt ramp to one image: the TONE_* curve from the luma histogram of the
+ rows the grid samples is folded into lut and level. TONE_OFF leaves the
+ ramp linear.
+*/
+void ascii_ramp_tone(AsciiRamp *ramp, const unsigned char *pixels, int width, int height,
+                     int rows, int tone);
+
+/* Buffer size for one row of text, NUL included */
+static inline size_t ascii_row_bytes(const AsciiRamp *ramp, int cols) {
+    return (size_t)cols * ramp->max_len + 1;
+}
+
+/* UTF-8 text of one row of cells, NUL-terminated; returns its length */
+size_t ascii_row_text(const AsciiRamp *ramp, const uint8_t *cells, int cols, char *out);
+
+/* Named color (black, white, red, green, blue, pink, purple); white if unknown */
+void parse_color(const char *name, uint8_t *r, uint8_t *g, uint8_t *b);
+
+/* Font used for glyph templates (default "font.ttf") */
+void ascii_engine_set_font(const char *path);
+
+/* Grid rows for an image of width x height at cols per line; at least 1 */
+int ascii_grid_rows(int width, int height, int cols, float char_aspect);
+
+/* Source width a cols-wide grid can still use in mode; anything wider may be decoded smaller */
+int ascii_source_width(int cols, int mode);
+
+/*
+ Fill rows * cols glyph indices (mode=halfblock: ascii_cell_bytes texels per
+ cell) from RGBA pixels. mode=shape builds its glyph templates on first use
+ per ramp (TTF, so the first call for a ramp must come from one thread).
+ Returns 0 on failure.
+*/
+int ascii_grid_fill(const unsigned char *pixels, int width, int height,
+                    int cols, int rows, const AsciiRamp *ramp, int mode, uint8_t *cells);
+
+/* Grid filled a few rows at a time, for conversions spread over several frames */
+typedef struct {
+    const unsigned char *pixels;
+    int width;
+    int height;
+    int cols;
+    int rows;
+    const AsciiRamp *ramp;      /* must outlive the job */
+    int mode;
+    uint8_t *cells;
+    int next_row;
+    float *error;               /* ramp mode: dithering error of this row and the next */
+    float *next_error;
+    void *scratch;              /* braille / edges mode: sub-pixel rows */
+} AsciiGridJob;
+
+/* Same contract as ascii_grid_fill; returns 0 on failure (nothing to end) */
+int ascii_grid_begin(AsciiGridJob *job, const unsigned char *pixels, int width, int height,
+                     int cols, int rows, const AsciiRamp *ramp, int mode, uint8_t *cells);
+
+/* Fill up to max_rows more rows (all if max_rows <= 0); returns rows left, -1 on failure */
+int ascii_grid_step(AsciiGridJob *job, int max_rows);
+void ascii_grid_end(AsciiGridJob *job);
+
+/* Number of shape templates for ramp, building them if needed; 0 if unusable */
+int ascii_shape_glyphs(const AsciiRamp *ramp);
+
+/* Ramp glyphs pre-blended fg over bg into palette indices, ready to stamp */
+typedef struct {
+    int cell_w;
+    int cell_h;
+    int bits;                   /* indexed PNG depth in use */
+    int palette_size;
+    uint8_t palette[256 * 3];
+    uint8_t *tiles;             /* cell_w * cell_h indices per ramp glyph */
+} AsciiTileset;
+
+/* bits = 0 picks the smallest exact depth; returns 1 on success */
+int ascii_tileset_build(AsciiTileset *ts, TTF_Font *font, const AsciiRamp *ramp,
+                        const uint8_t fg[3], const uint8_t bg[3], int bits);
+void ascii_tileset_free(AsciiTileset *ts);
+
+/* Stream the grid as an indexed PNG into sink; returns bytes written or 0 */
+size_t ascii_write_png(const AsciiTileset *ts, const uint8_t *cells, int cols, int rows,
+                       int level, png_sink_func sink, void *ctx);
+
+/*
+ mode=pixel: the image box-filtered to bw x bh opaque RGBA blocks in one
+ pass over its rows, tone (if not NULL) applied per channel. Returns 0 if
+ out of memory.
+*/
+int ascii_pixel_blocks(const unsigned char *rgba, int width, int height, int bw, int bh,
+                       const uint8_t *tone, uint8_t *out);
+
+/* Half-block grid as an RGB PNG of cell_w * cell_h cells, top half above cell_h / 2 */
+size_t ascii_write_halfblock_png(const uint8_t *texels, int cols, int rows, int cell_w, int cell_h,
+                                 int level, png_sink_func sink, void *ctx);
+
+/* The same from palette indices (one per texel, palette=N), as an indexed PNG */
+size_t ascii_write_halfblock_indexed_png(const uint8_t *index, int cols, int rows, int cell_w, int cell_h,
+                                         const Palette *pal, int level, png_sink_func sink, void *ctx);
+
+/* Longest ANSI truecolor row of half blocks, NUL included */
+static inline size_t ascii_halfblock_ansi_bytes(int cols) {
+    return (size_t)cols * 39 + 5;
+}
+
+/* One half-block row as ANSI truecolor escapes, reset at the end; returns its length */
+size_t ascii_halfblock_row_ansi(const uint8_t *texels, int cols, int row, char *out);
+
+/* Export formats */
+#define ASCII_FORMAT_PNG   0
+#define ASCII_FORMAT_TXT   1    /* UTF-8 rows (half blocks keep their ANSI colors) */
+#define ASCII_FORMAT_ANSI  2    /* rows in fg / bg truecolor escapes, per cell for half blocks */
+#define ASCII_FORMAT_HTML  3    /* <pre> page, color runs as spans for half blocks */
+
+/* Text is handed to the sink in pieces of at most this many bytes */
+#define ASCII_TEXT_CHUNK   (64 * 1024)
+
+/* ASCII_FORMAT_* for png/txt/ansi/html, ASCII_FORMAT_PNG if unknown */
+int ascii_format_from_name(const char *name);
+const char *ascii_format_name(int format);
+
+/* File extension of format, dot included */
+const char *ascii_format_ext(int format);
+
+/*
+ Stream the grid of mode as TXT, ANSI or HTML into sink, a chunk at a time,
+ without rasterizing; fg / bg color the glyph modes. Returns bytes written or 0.
+*/
+size_t ascii_write_text(const AsciiRamp *ramp, int mode, const uint8_t *cells, int cols, int rows, int format,
+                        const uint8_t fg[3], const uint8_t bg[3], png_sink_func sink, void *ctx);
+
+#endif /* ASCII_ENGINE_H */
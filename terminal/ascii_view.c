@@ -0,0 +1,269 @@
+#include "ascii_view.h"
+#include "global.h"
+#include "glyph_cache.h"
+#include "luma_pyramid.h"
+#include "pipeline_mem.h"
+#include "workers.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static struct {
+    BOOL active;
+    LumaPyramid pyramid;
+    float zoom;             /* 1 = whole image */
+    float cx;               /* crop center, level 0 pixels */
+    float cy;
+    BOOL dirty;
+
+    int cols;
+    int rows;
+    AsciiRamp ramp;
+    int mode;
+
+    int plane_w;            /* resampled crop the grid is filled from */
+    int plane_h;
+    uint8_t *luma;          /* plane_w * plane_h */
+    uint8_t *rgba;          /* the same as gray RGBA, what ascii_grid_fill reads */
+    uint8_t *cells;         /* rows * cols */
+
+    GlyphTiles glyphs;
+    int tex_w;
+    int tex_h;
+    uint8_t *compose;       /* tex_w * tex_h RGBA */
+    SDL_Texture *texture;   /* owned by its scrollback line */
+    double frame_ms;
+} view;
+
+int ascii_view_active(void) {
+    return view.active;
+}
+
+static TerminalLine *find_view_line(void) {
+    for (int i = 0; i < _terminal.line_count; i++) {
+        TerminalLine *line = &_terminal.lines[i];
+        if ((line->flags & LINE_FLAG_VIEWING) && line->texture == view.texture) return line;
+    }
+    return NULL;
+}
+
+static int build_view_tiles(int font_size) {
+    if (TTF_WasInit() == 0) TTF_Init();
+    TTF_Font *font = TTF_OpenFont(FONT_PATH, font_size);
+    if (!font) return 0;
+    TTF_SetFontStyle(font, TTF_STYLE_BOLD);
+
+    const char *strs[ASCII_RAMP_MAX];
+    for (int i = 0; i < view.ramp.count; i++) strs[i] = view.ramp.glyph[i];
+
+    int ok = glyph_tiles_build(&view.glyphs, font, strs, view.ramp.count, _terminal.settings.font_color);
+    TTF_CloseFont(font);
+    return ok;
+}
+
+/* Keep the crop inside the image */
+static void clamp_view(void) {
+    const LumaLevel *l0 = &view.pyramid.level[0];
+    if (view.zoom < 1.0f) view.zoom = 1.0f;
+    if (view.zoom > VIEW_MAX_ZOOM) view.zoom = VIEW_MAX_ZOOM;
+
+    float half_w = l0->width / view.zoom * 0.5f, half_h = l0->height / view.zoom * 0.5f;
+    if (view.cx < half_w) view.cx = half_w;
+    if (view.cx > l0->width - half_w) view.cx = l0->width - half_w;
+    if (view.cy < half_h) view.cy = half_h;
+    if (view.cy > l0->height - half_h) view.cy = l0->height - half_h;
+}
+
+/* Resample the crop, fill the grid and stamp it into the line's texture */
+static int render_view(void) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    const LumaLevel *l0 = &view.pyramid.level[0];
+    float w = l0->width / view.zoom, h = l0->height / view.zoom;
+
+    luma_pyramid_sample(&view.pyramid, view.cx - w * 0.5f, view.cy - h * 0.5f, w, h,
+                        view.plane_w, view.plane_h, view.luma);
+
+    size_t n = (size_t)view.plane_w * view.plane_h;
+    for (size_t i = 0; i < n; i++) {
+        uint8_t *px = view.rgba + i * 4;
+        px[0] = px[1] = px[2] = view.luma[i];
+        px[3] = 255;
+    }
+
+    if (!ascii_grid_fill(view.rgba, view.plane_w, view.plane_h, view.cols, view.rows,
+                         &view.ramp, view.mode, view.cells)) {
+        return 0;
+    }
+
+    GlyphStamp job = {
+        .cells = view.cells,
+        .cols = view.cols,
+        .cell_w = view.glyphs.cell_w,
+        .cell_h = view.glyphs.cell_h,
+        .bpp = 4,
+        .tiles = view.glyphs.rgba,
+        .pixels = view.compose,
+        .pitch = view.tex_w * 4,
+    };
+    run_bands(glyph_stamp_rows, &job, view.rows);
+    SDL_UpdateTexture(view.texture, NULL, view.compose, view.tex_w * 4);
+
+    view.frame_ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    _terminal.dirty = TRUE;
+    return 1;
+}
+
+void ascii_view_stop(void) {
+    if (!view.active) return;
+
+    // The line keeps the last frame and owns the texture as before
+    TerminalLine *line = find_view_line();
+    if (line) {
+        line->flags = (TerminalLineFlags)(line->flags & ~LINE_FLAG_VIEWING);
+        char buf[128];
+        snprintf(buf, sizeof(buf), "View closed at %.2fx (last frame %.1f ms)", view.zoom, view.frame_ms);
+        add_terminal_line(buf, LINE_FLAG_SYSTEM);
+    }
+
+    luma_pyramid_free(&view.pyramid);
+    glyph_tiles_free(&view.glyphs);
+    free(view.luma);
+    free(view.rgba);
+    free(view.cells);
+    free(view.compose);
+    memset(&view, 0, sizeof(view));
+}
+
+int ascii_view_start(const CachedImage *img, int cols, float char_aspect, int font_size,
+                     const char *ramp_utf8, int mode, int tone) {
+    ascii_view_stop();
+    if (!img || !img->pixels || cols <= 0) return 0;
+
+    // Color modes need color, which the pyramid does not keep
+    if (ascii_mode_color(mode)) mode = ASCII_MODE_RAMP;
+    if (!ascii_ramp_for_mode(&view.ramp, ramp_utf8, mode)) {
+        add_terminal_line("Error: Empty ramp", LINE_FLAG_ERROR);
+        return 0;
+    }
+
+    view.cols = cols;
+    view.rows = ascii_grid_rows(img->width, img->height, cols, char_aspect);
+    view.mode = mode;
+    ascii_ramp_tone(&view.ramp, img->pixels, img->width, img->height, view.rows, tone);
+
+    view.plane_w = ascii_source_width(cols, mode);
+    view.plane_h = (int)((long long)view.plane_w * img->height / img->width);
+    if (view.plane_h < view.rows) view.plane_h = view.rows;
+
+    // Admission trims the cache; the pixels are only read until the pyramid is built
+    size_t plane = (size_t)view.plane_w * view.plane_h;
+    image_cache_pin(img);
+    int admitted = pipeline_admit(luma_pyramid_bytes(img->width, img->height) + plane * 5);
+    int built = admitted && luma_pyramid_build(&view.pyramid, img->pixels, img->width, img->height);
+    image_cache_unpin(img);
+    if (!admitted) {
+        add_terminal_line("Error: Image too large to view within the memory budget", LINE_FLAG_ERROR);
+        return 0;
+    }
+    if (!built || !build_view_tiles(font_size)) {
+        add_terminal_line("Error: Cannot set up the image viewer", LINE_FLAG_ERROR);
+        luma_pyramid_free(&view.pyramid);
+        glyph_tiles_free(&view.glyphs);
+        memset(&view, 0, sizeof(view));
+        return 0;
+    }
+    view.active = TRUE;
+
+    view.tex_w = cols * view.glyphs.cell_w;
+    view.tex_h = view.rows * view.glyphs.cell_h;
+    view.luma = (uint8_t *)image_cache_alloc(plane);
+    view.rgba = (uint8_t *)image_cache_alloc(plane * 4);
+    view.cells = (uint8_t *)image_cache_alloc((size_t)cols * view.rows);
+    view.compose = (uint8_t *)image_cache_alloc((size_t)view.tex_w * view.tex_h * 4);
+    if (view.luma && view.rgba && view.cells && view.compose) {
+        view.texture = SDL_CreateTexture(_sdl.renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING,
+                                         view.tex_w, view.tex_h);
+    }
+    if (!view.texture) {
+        add_terminal_line("Error: Cannot set up the image viewer (try a smaller wide=)", LINE_FLAG_ERROR);
+        ascii_view_stop();
+        return 0;
+    }
+    SDL_SetTextureBlendMode(view.texture, SDL_BLENDMODE_BLEND);
+
+    const LumaLevel *l0 = &view.pyramid.level[0];
+    view.zoom = 1.0f;
+    view.cx = l0->width * 0.5f;
+    view.cy = l0->height * 0.5f;
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "Viewing %d × %d as %d × %d chars (%d pyramid levels): arrows pan, +/- zoom, 0 resets, Esc/q exits",
+             l0->width, l0->height, cols, view.rows, view.pyramid.levels);
+    add_terminal_line(buf, LINE_FLAG_SYSTEM);
+
+    if (!render_view()) {
+        SDL_DestroyTexture(view.texture);
+        add_terminal_line("Error: Out of memory while building ASCII grid", LINE_FLAG_ERROR);
+        ascii_view_stop();
+        return 0;
+    }
+    add_terminal_texture_line(view.texture, view.tex_w, view.tex_h, LINE_FLAG_VIEWING);
+    return 1;
+}
+
+int ascii_view_handle_event(const SDL_Event *e) {
+    if (!view.active) return 0;
+
+    // Keys typed for the viewer must not reach the input line
+    if (e->type == SDL_TEXTINPUT) return 1;
+    if (e->type != SDL_KEYDOWN) return 0;
+
+    const LumaLevel *l0 = &view.pyramid.level[0];
+    float pan_x = l0->width / view.zoom * VIEW_PAN_STEP;
+    float pan_y = l0->height / view.zoom * VIEW_PAN_STEP;
+
+    switch (e->key.keysym.sym) {
+        case SDLK_LEFT:     view.cx -= pan_x; break;
+        case SDLK_RIGHT:    view.cx += pan_x; break;
+        case SDLK_UP:       view.cy -= pan_y; break;
+        case SDLK_DOWN:     view.cy += pan_y; break;
+        case SDLK_EQUALS:
+        case SDLK_PLUS:
+        case SDLK_KP_PLUS:  view.zoom *= VIEW_ZOOM_STEP; break;
+        case SDLK_MINUS:
+        case SDLK_KP_MINUS: view.zoom /= VIEW_ZOOM_STEP; break;
+        case SDLK_0:
+        case SDLK_KP_0:
+            view.zoom = 1.0f;
+            view.cx = l0->width * 0.5f;
+            view.cy = l0->height * 0.5f;
+            break;
+        case SDLK_ESCAPE:
+        case SDLK_q:
+        case SDLK_RETURN:
+            ascii_view_stop();
+            return 1;
+        default:
+            return 1;
+    }
+    clamp_view();
+    view.dirty = TRUE;     // several presses in one frame render once
+    return 1;
+}
+
+void ascii_view_tick(void) {
+    if (!view.active) return;
+
+    // Scrolled out of the FIFO or cleared: the texture went with the line
+    if (!find_view_line()) {
+        ascii_view_stop();
+        return;
+    }
+    if (!view.dirty) return;
+
+    view.dirty = FALSE;
+    if (!render_view()) {
+        add_terminal_line("Error: Out of memory while building ASCII grid", LINE_FLAG_ERROR);
+        ascii_view_stop();
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef ASCII_VIEW_H
+#define ASCII_VIEW_H
+
+#include "ascii_engine.h"
+#include "image_cache.h"
+#include "sdl.h"
+
+/*
+Interactive zoom and pan over the last converted image (view=1)
+
+The image is reduced once to a luma mip pyramid; every key press resamples
+only the visible crop from the level closest to the grid's resolution, fills
+the grid and re-stamps it into one streaming texture in the scrollback. The
+cost per frame depends on the grid size, not on the image size. While the
+viewer is active it takes the keyboard: arrows pan, + / - zoom, 0 resets,
+Escape or q leaves the last frame in the scrollback.
+*/
+
+#define VIEW_ZOOM_STEP  1.25f
+#define VIEW_PAN_STEP   0.1f    /* of the visible crop per arrow press */
+#define VIEW_MAX_ZOOM   64.0f
+
+/*
+ Start viewing img at cols characters per line; mode=halfblock and
+ mode=pixel fall back to the ramp. The tone curve is fitted to the whole
+ image once. Returns 0 if nothing could be started (already reported).
+*/
+int ascii_view_start(const CachedImage *img, int cols, float char_aspect, int font_size,
+                     const char *ramp_utf8, int mode, int tone);
+
+/* 1 if the viewer consumed e; call for every event while active */
+int ascii_view_handle_event(const SDL_Event *e);
+
+/* Re-render after input; call once per main loop tick */
+void ascii_view_tick(void);
+
+/* Leave the current frame in the scrollback and release the pyramid */
+void ascii_view_stop(void);
+
+int ascii_view_active(void);
+
+#endif /* ASCII_VIEW_H */
@@ -0,0 +1,120 @@
+#include "braille.h"
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* 4x4 ordered dither, scaled to thresholds b * 16 + 8 */
+static const uint8_t bayer[4][4] = {
+    {  0,  8,  2, 10 },
+    { 12,  4, 14,  6 },
+    {  3, 11,  1,  9 },
+    { 15,  7, 13,  5 },
+};
+
+/* Dot bit of sub-row y, left and right column */
+static const uint8_t dot_bit[4][2] = {
+    { 0x01, 0x08 },
+    { 0x02, 0x10 },
+    { 0x04, 0x20 },
+    { 0x40, 0x80 },
+};
+
+static inline uint8_t threshold(int y, int x) {
+    return (uint8_t)(bayer[y & 3][x & 3] * 16 + 8);
+}
+
+void braille_ramp_text(char out[BRAILLE_RAMP_BYTES]) {
+    // U+2800 + i: E2 A0+(i>>6) 80+(i&63)
+    for (int i = 0; i < 256; i++) {
+        out[i * 3] = (char)0xE2;
+        out[i * 3 + 1] = (char)(0xA0 + (i >> 6));
+        out[i * 3 + 2] = (char)(0x80 + (i & 63));
+    }
+    out[256 * 3] = '\0';
+}
+
+size_t braille_scratch_bytes(int cols) {
+    // Source column per sub-column, then 4 sub-rows of luma
+    return (size_t)cols * 2 * sizeof(int) + (size_t)cols * 2 * 4;
+}
+
+/* Dot mask of the cell whose left sub-column is x */
+static inline uint8_t pack_cell(const uint8_t *luma, int stride, int x) {
+    uint8_t m = 0;
+    for (int y = 0; y < 4; y++) {
+        const uint8_t *p = luma + (size_t)y * stride + x;
+        if (p[0] > threshold(y, x)) m |= dot_bit[y][0];
+        if (p[1] > threshold(y, x + 1)) m |= dot_bit[y][1];
+    }
+    return m;
+}
+
+#if defined(__wasm_simd128__) || defined(__SSE2__)
+#define BRAILLE_SIMD 1
+
+/* Dot masks of 8 cells from 16 sub-pixels in each of the 4 sub-rows at x (x % 4 == 0) */
+static inline void pack8(const uint8_t *luma, int stride, int x, uint8_t *out) {
+#if defined(__wasm_simd128__)
+    v128_t acc = wasm_i8x16_splat(0);
+    for (int y = 0; y < 4; y++) {
+        const uint8_t *t = bayer[y];
+        v128_t thr = wasm_u8x16_make(t[0]*16+8, t[1]*16+8, t[2]*16+8, t[3]*16+8, t[0]*16+8, t[1]*16+8, t[2]*16+8, t[3]*16+8,
+                                     t[0]*16+8, t[1]*16+8, t[2]*16+8, t[3]*16+8, t[0]*16+8, t[1]*16+8, t[2]*16+8, t[3]*16+8);
+        v128_t bit = wasm_u16x8_splat((uint16_t)(dot_bit[y][0] | dot_bit[y][1] << 8));
+        v128_t lit = wasm_u8x16_gt(wasm_v128_load(luma + (size_t)y * stride + x), thr);
+        acc = wasm_v128_or(acc, wasm_v128_and(lit, bit));
+    }
+    // Left dots in the low byte of each 16-bit lane, right dots in the high byte
+    v128_t mask = wasm_v128_or(wasm_v128_and(acc, wasm_u16x8_splat(0xFF)), wasm_u16x8_shr(acc, 8));
+    wasm_v128_store64_lane(out, wasm_u8x16_narrow_i16x8(mask, mask), 0);
+#elif defined(__SSE2__)
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    __m128i acc = _mm_setzero_si128();
+    for (int y = 0; y < 4; y++) {
+        // Unsigned compare as signed, both sides biased by 0x80
+        const uint8_t *t = bayer[y];
+        __m128i thr = _mm_set1_epi32((int)((uint32_t)(t[0]*16+8) | (uint32_t)(t[1]*16+8) << 8 |
+                                           (uint32_t)(t[2]*16+8) << 16 | (uint32_t)(t[3]*16+8) << 24));
+        __m128i bit = _mm_set1_epi16((short)(dot_bit[y][0] | dot_bit[y][1] << 8));
+        __m128i v = _mm_loadu_si128((const __m128i *)(luma + (size_t)y * stride + x));
+        __m128i lit = _mm_cmpgt_epi8(_mm_xor_si128(v, bias), _mm_xor_si128(thr, bias));
+        acc = _mm_or_si128(acc, _mm_and_si128(lit, bit));
+    }
+    __m128i mask = _mm_or_si128(_mm_and_si128(acc, _mm_set1_epi16(0xFF)), _mm_srli_epi16(acc, 8));
+    _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(mask, mask));
+#endif
+}
+#endif
+
+void braille_rows(const unsigned char *rgba, int width, int height, int cols, int rows,
+                  const uint8_t *tone, void *scratch, uint8_t *cells, int begin, int end) {
+    int plane_w = cols * 2;
+    int *sx = (int *)scratch;
+    uint8_t *luma = (uint8_t *)(sx + plane_w);
+
+    for (int x = 0; x < plane_w; x++) sx[x] = (int)((long long)x * width / plane_w);
+
+    for (int row = begin; row < end; row++) {
+        // Point-sampled luma of the cell row's 4 sub-rows
+        for (int y = 0; y < 4; y++) {
+            int sy = (int)((long long)(row * 4 + y) * height / ((long long)rows * 4));
+            const unsigned char *src = rgba + (size_t)sy * width * 4;
+            uint8_t *dst = luma + (size_t)y * plane_w;
+            for (int x = 0; x < plane_w; x++) {
+                const unsigned char *px = src + (size_t)sx[x] * 4;
+                unsigned l = (77 * px[0] + 150 * px[1] + 29 * px[2]) >> 8;
+                dst[x] = tone ? tone[l] : (uint8_t)l;
+            }
+        }
+
+        uint8_t *out = cells + (size_t)row * cols;
+        int x = 0;
+#ifdef BRAILLE_SIMD
+        for (; x + 16 <= plane_w; x += 16) pack8(luma, plane_w, x, out + x / 2);
+#endif
+        for (; x < plane_w; x += 2) out[x / 2] = pack_cell(luma, plane_w, x);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef BRAILLE_H
+#define BRAILLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Braille sub-cell mode
+
+Each cell covers 2 x 4 sub-pixels. A sub-pixel brighter than its 4x4
+ordered-dither threshold raises one dot of a U+2800 pattern, so a grid holds
+eight samples per character. The cell value is the dot mask, which is also
+the glyph's index in the braille ramp.
+
+Dot bits:   0x01 0x08
+            0x02 0x10
+            0x04 0x20
+            0x40 0x80
+*/
+
+#define BRAILLE_RAMP_BYTES  (256 * 3 + 1)
+
+/* The 256 patterns in dot-mask order, as one UTF-8 ramp string */
+void braille_ramp_text(char out[BRAILLE_RAMP_BYTES]);
+
+/* Scratch bytes braille_rows needs for a cols-wide grid */
+size_t braille_scratch_bytes(int cols);
+
+/*
+ Dot masks of grid rows [begin, end) of a rows * cols grid over RGBA pixels.
+ Sub-pixel luma goes through tone (256 entries) unless it is NULL.
+*/
+void braille_rows(const unsigned char *rgba, int width, int height, int cols, int rows,
+                  const uint8_t *tone, void *scratch, uint8_t *cells, int begin, int end);
+
+#endif /* BRAILLE_H */
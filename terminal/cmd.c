@@ -9,6 +9,8 @@
 #include "settings.h"
 #include "base64.h"
 #include "ascii_converter.h"
+#include "pipeline_mem.h"
+#include "png_writer.h"
 #include <emscripten/emscripten.h>
 
 
@@ -30,7 +32,7 @@ Command commands[] = {
     {"translate",  "Translate text",          cmd_translate},
     {"weather",  "Weather Info.",          cmd_weather},
     {"man",  "Display documentation",          cmd_man},
-    {"to_ascii", "Convert image from URL to ASCII art", cmd_to_ascii},
+    {"to_ascii", "Convert image from URL or file to ASCII art", cmd_to_ascii},
     {"debug", "App debug dump",app_debug_dump },
     {"version", "Version",cmd_version },
     {"log", "Log message",cmd_log },
@@ -183,7 +185,7 @@ void cmd_help(const char *args) {
     add_terminal_line("  exit                         - Exit root access", LINE_FLAG_NONE);
     add_terminal_line("  translate <src> <tgt> <text> - Translate text via MyMemory API", LINE_FLAG_NONE);
     add_terminal_line("  man <command>                - Show command documentation", LINE_FLAG_NONE);
-    add_terminal_line("  to_ascii <link>              - Convert image to ASCII", LINE_FLAG_NONE);
+    add_terminal_line("  to_ascii <link|path>         - Convert image to ASCII", LINE_FLAG_NONE);
     add_terminal_line("  debug                        - Get App context dump (dev)", LINE_FLAG_NONE);
     add_terminal_line("  log                          - Get log messages", LINE_FLAG_NONE);
     add_terminal_line("  editor                       - Write, Code, C compilator", LINE_FLAG_NONE);
@@ -439,7 +441,7 @@ void cmd_to_ascii(const char *args) {
     _image_processing_pending = 1;
 
     if (!args || strlen(args) == 0) {
-        add_terminal_line("Usage: to_ascii <image_url> [download=1 wide=300 font_size=6 bg=black color=white name=output ramp=1]", LINE_FLAG_SYSTEM);
+        add_terminal_line("Usage: to_ascii <image_url|path> [download=1 wide=300 font_size=6 bg=black color=white name=output ramp=1 mode=ramp|shape|braille|halfblock|edges|pixel tone=off level=5 bits=0 format=png|txt|ansi|html palette=16 view=1], to_ascii cache=flush, to_ascii mem=show|<MB>", LINE_FLAG_SYSTEM);
         _image_processing_pending = 0;
         return;
     }
@@ -448,20 +450,45 @@ void cmd_to_ascii(const char *args) {
     char options_str[1024] = {0};
     sscanf(args, "%1023s %[^\n]", url, options_str);
 
-    if (strncmp(url, "http://", 7) != 0 && strncmp(url, "https://", 8) != 0) {
-        add_terminal_line("Error: Please provide a valid http/https URL", LINE_FLAG_SYSTEM);
+    // Cache and budget controls use the option form, so any bare name stays a file path
+    if (strcmp(url, "cache=flush") == 0) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Image cache flushed (%d images, %zu KB)", image_cache_count(), image_cache_bytes() / 1024);
+        image_cache_flush();
+        add_terminal_line(msg, LINE_FLAG_SYSTEM);
         _image_processing_pending = 0;
         return;
     }
 
+    if (strncmp(url, "mem=", 4) == 0) {
+        char msg[160];
+        int mb = atoi(url + 4);
+        if (mb > 0) pipeline_set_budget((size_t)mb * 1024 * 1024);
+        pipeline_report(msg, sizeof(msg));
+        add_terminal_line(msg, LINE_FLAG_SYSTEM);
+        _image_processing_pending = 0;
+        return;
+    }
+
+    // Anything else is a path: files dropped onto the page land in /drop
+    int remote = strncmp(url, "http://", 7) == 0 || strncmp(url, "https://", 8) == 0;
+
 	// Default
     ExportOptions opts;
     opts.chars_wide = 130;
     opts.font_size = 7;
     opts.ramp = RAMP_1;
+    opts.mode = ASCII_MODE_RAMP;
+    opts.tone = TONE_OFF;
     opts.fg[0] = 255; opts.fg[1] = 255; opts.fg[2] = 255;
     opts.bg[0] = 0;   opts.bg[1] = 0;   opts.bg[2] = 0;
     opts.filename = "ascii_art.png";
+    opts.png_level = PNG_LEVEL_DEFAULT;
+    opts.png_bits = 0;
+    opts.format = ASCII_FORMAT_PNG;
+    opts.view = 0;
+    opts.palette = 0;
+    int named = 0;
 
     _image_download_pending = 0;
 
@@ -481,15 +508,28 @@ void cmd_to_ascii(const char *args) {
                 parse_color(val, &opts.fg[0], &opts.fg[1], &opts.fg[2]);
             } else if (strcmp(key, "name") == 0) {
                 opts.filename = strdup(val);
+                named = 1;
             } else if (strcmp(key, "ramp") == 0) {
-                int r = atoi(val);
-                if      (r == 1) opts.ramp = RAMP_1;
-                else if (r == 2) opts.ramp = RAMP_2;
-                else if (r == 3) opts.ramp = RAMP_3;
-                else if (r == 4) opts.ramp = RAMP_4;
-				else if (r == 5) opts.ramp = RAMP_5;
-				else if (r == 6) opts.ramp = RAMP_6;
-                else             opts.ramp = RAMP_1;
+                opts.ramp = ascii_ramp_preset(atoi(val));
+            } else if (strcmp(key, "mode") == 0) {
+                opts.mode = ascii_mode_from_name(val);
+            } else if (strcmp(key, "tone") == 0) {
+                opts.tone = tone_from_name(val);
+            } else if (strcmp(key, "level") == 0) {
+                int l = atoi(val);
+                opts.png_level = (l < 0) ? 0 : (l > 9) ? 9 : l;
+            } else if (strcmp(key, "bits") == 0) {
+                int b = atoi(val);
+                opts.png_bits = (b == 1 || b == 2 || b == 4 || b == 8) ? b : 0;
+            } else if (strcmp(key, "format") == 0) {
+                // A text format is only ever a download
+                opts.format = ascii_format_from_name(val);
+                if (opts.format != ASCII_FORMAT_PNG) _image_download_pending = TRUE;
+            } else if (strcmp(key, "view") == 0) {
+                opts.view = atoi(val) != 0;
+            } else if (strcmp(key, "palette") == 0) {
+                int n = atoi(val);
+                opts.palette = (n <= 0) ? 0 : (n < 2) ? 2 : (n > PALETTE_MAX) ? PALETTE_MAX : n;
             }
         }
 
@@ -497,6 +537,24 @@ void cmd_to_ascii(const char *args) {
         if (!next) break;
         ptr = next + 1;
     }
+    if (!named && opts.format != ASCII_FORMAT_PNG) {
+        static char default_name[32];
+        snprintf(default_name, sizeof(default_name), "ascii_art%s", ascii_format_ext(opts.format));
+        opts.filename = default_name;
+    }
+    global_opts = opts;
+
+    if (!remote) {
+        ascii_convert_file(url);
+        _image_processing_pending = 0;
+        return;
+    }
+
+    // Same URL as a recent run: re-render from the decoded pixels, no fetch
+    if (ascii_convert_cached(url)) {
+        _image_processing_pending = 0;
+        return;
+    }
 	
 	#ifdef __EMSCRIPTEN__
 		// Store the request in sessionStorage
@@ -509,7 +567,6 @@ void cmd_to_ascii(const char *args) {
 
     add_terminal_line("Fetching and processing image...", LINE_FLAG_SYSTEM);
     add_terminal_line("(This may take a few seconds depending on image size)", LINE_FLAG_SYSTEM);
-    global_opts = opts;
 }
 
 
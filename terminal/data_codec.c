@@ -85,12 +85,13 @@ ManEntry man_db[] = {
 		"--------------------------------------------------\n"
 		"                   TO_ASCII                       \n"
 		"--------------------------------------------------\n\n"
-		"to_ascii <link> [options]\n"
-		"  Converts an online image into ASCII art.\n"
+		"to_ascii <link|path> [options]\n"
+		"  Converts an online image or a local file into ASCII art.\n"
 		"  By default, it displays the ASCII preview in the terminal.\n"
 		"  Optional flags allow exporting to a high-resolution PNG.\n\n"
 		"Usage:\n"
-		"  to_ascii <image_url> [options]\n\n"
+		"  to_ascii <image_url> [options]\n"
+		"  to_ascii <path> [options]\n\n"
 		"Options:\n"
 		"  download=1       Export the ASCII art as a high-resolution PNG.\n"
 		"  wide=<number>    Number of characters per line (ASCII width). Default: 130\n"
@@ -98,7 +99,27 @@ ManEntry man_db[] = {
 		"  bg=<color>       Background color for PNG. Options: black, white, red, green, blue, pink, purple. Default: black\n"
 		"  color=<color>    Font color for PNG. Options same as bg. Default: white\n"
 		"  name=<filename>  Output PNG file name. Default: ascii_highres.png\n"
-		"  ramp=<1-4>       ASCII character ramp preset. Default: 1\n\n"
+		"  ramp=<1-4>       ASCII character ramp preset. Default: 1\n"
+		"  mode=<ramp|shape|braille|halfblock|edges|pixel> Glyph choice: ramp = by brightness, shape = glyph that best\n"
+		"                   matches the cell's outline (sharper edges), braille = 2x4 dithered\n"
+		"                   dots per cell (8x the samples; ramp= is ignored), halfblock = true\n"
+		"                   color \"▀\" cells, top pixel over bottom pixel (twice the rows),\n"
+		"                   edges = | / - \\ _ along contours, the ramp elsewhere (line art),\n"
+		"                   pixel = preview as square color blocks, one image, no text\n"
+		"                   (downloads as halfblock).\n"
+		"                   Default: ramp\n"
+		"  tone=<mode>      Fit the brightness mapping to each image: off, levels (stretch to full\n"
+		"                   range), equalize (spread evenly over the ramp), auto (levels + gamma).\n"
+		"                   Default: off\n"
+		"  level=<0-9>      PNG compression: 0 = none, 1 = fastest, 9 = smallest. Default: 5\n"
+		"  bits=<1|2|4|8>   Indexed PNG depth; fewer bits quantize antialiasing. Default: auto (exact)\n"
+		"  format=<fmt>     Download as png, txt, ansi (truecolor escapes) or html. Text formats\n"
+		"                   skip rasterizing and imply download=1. Default: png\n"
+		"  palette=<2-256>  mode=halfblock: fit N colors to the image (k-means) and export an\n"
+		"                   indexed PNG, smaller and faster to encode. Default: true color\n"
+		"  view=1           Open the preview in a zoom / pan viewer: arrows pan, + / - zoom,\n"
+		"                   0 resets, Esc or q leaves the last view in the scrollback.\n"
+		"                   Large JPEGs are decoded at full size. Default: 0\n\n"
 		"ASCII Ramp Presets:\n"
 		"  ramp=1  Wide tonal range\n"
 		"          Smooth gradients and rich shading.\n"
@@ -115,17 +136,36 @@ ManEntry man_db[] = {
 		"Examples:\n"
 		"  to_ascii https://i.imgur.com/example.jpg\n"
 		"  to_ascii https://picsum.photos/800/600 ramp=2\n"
-		"  to_ascii https://picsum.photos/800/600 download=1 ramp=4 wide=300 font_size=15\n\n"
+		"  to_ascii https://picsum.photos/800/600 mode=shape wide=200\n"
+		"  to_ascii https://picsum.photos/800/600 mode=braille\n"
+		"  to_ascii https://picsum.photos/800/600 tone=auto\n"
+		"  to_ascii https://picsum.photos/4000/3000 view=1 wide=160\n"
+		"  to_ascii https://picsum.photos/800/600 download=1 ramp=4 wide=300 font_size=15\n"
+		"  to_ascii https://picsum.photos/800/600 mode=halfblock format=html wide=200\n"
+		"  to_ascii https://picsum.photos/800/600 mode=halfblock palette=16 download=1\n"
+		"  to_ascii /drop/photo.jpg mode=shape\n\n"
 		"Notes:\n"
 		"  - Copy/paste of images is not supported.\n"
-		"  - Images must be accessible via direct URL.\n"
+		"  - Images must be accessible via direct URL, or be local files.\n"
+		"  - Drop an image onto the terminal to convert it: it is stored as\n"
+		"    /drop/<name> (spaces become _) for later runs with other options.\n"
+		"    The last 8 drops are kept; older ones are removed.\n"
 		"  - Some websites block image access due to CORS restrictions.\n"
 		"  - Working sources usually include Imgur, Picsum, Wikimedia.\n"
-		"  - Unicode ramps may not render correctly in all terminals.\n\n"
+		"  - Unicode ramps may not render correctly in all terminals.\n"
+		"  - Animated GIFs play in the terminal; download=1 exports the first frame.\n"
+		"  - Recent images stay decoded: re-running to_ascii on the same URL with other\n"
+		"    options skips the download. 'to_ascii cache=flush' frees them.\n"
+		"  - 'to_ascii mem=show' shows pipeline memory; 'to_ascii mem=64' sets a\n"
+		"    64 MB budget. Images that cannot fit it are refused before decoding.\n"
+		"  - Any other first word is a URL or path; a file named like cache=flush\n"
+		"    or mem=64 is reached as ./cache=flush.\n"
+		"  - Large previews show a coarse grid at once and sharpen in place.\n"
+		"  - Big JPEGs are decoded at 1/2, 1/4 or 1/8 size, as much as 'wide' allows.\n\n"
 		"Image Tips:\n"
 		"  - Use small to medium images for faster processing.\n"
 		"  - High-contrast photos give the best results.\n"
-		"  - Avoid flat colors or very dark images.\n"
+		"  - For very dark or low-contrast images, try tone=auto or tone=equalize.\n"
 		"  - Increasing 'wide' and 'font_size' improves export resolution.\n\n"
 		"--------------------------------------------------\n"
 		"          Type 'to_ascii <image_url> [options]'   \n"
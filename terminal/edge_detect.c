@@ -0,0 +1,123 @@
+#include "edge_detect.h"
+#include <stdlib.h>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ Scratch: source column per sample column, gx / gy of the cell row's two
+ sample rows, then 4 rows of luma with the border sample repeated on each side.
+*/
+typedef struct {
+    int *sx;
+    int16_t *gx[2];
+    int16_t *gy[2];
+    uint8_t *luma[4];
+} EdgeScratch;
+
+static EdgeScratch scratch_layout(void *scratch, int plane_w) {
+    EdgeScratch s;
+    s.sx = (int *)scratch;
+    int16_t *g = (int16_t *)(s.sx + plane_w);
+    for (int i = 0; i < 2; i++) {
+        s.gx[i] = g + (size_t)(2 * i) * plane_w;
+        s.gy[i] = g + (size_t)(2 * i + 1) * plane_w;
+    }
+    uint8_t *l = (uint8_t *)(g + (size_t)4 * plane_w);
+    for (int i = 0; i < 4; i++) s.luma[i] = l + (size_t)i * (plane_w + 2);
+    return s;
+}
+
+size_t edge_scratch_bytes(int cols) {
+    size_t plane_w = (size_t)cols * 2;
+    return plane_w * sizeof(int) + 4 * plane_w * sizeof(int16_t) + 4 * (plane_w + 2);
+}
+
+/* Sobel gx / gy of the middle row from rows above and below; x is the sample column */
+static void sobel_row(const uint8_t *up, const uint8_t *mid, const uint8_t *down, int plane_w,
+                      int16_t *gx, int16_t *gy) {
+    int x = 0;
+#if defined(__wasm_simd128__)
+    for (; x + 8 <= plane_w; x += 8) {
+        // Rows are offset by one sample, so x, x+1 and x+2 are the left, center and right taps
+        v128_t ul = wasm_u16x8_load8x8(up + x), uc = wasm_u16x8_load8x8(up + x + 1), ur = wasm_u16x8_load8x8(up + x + 2);
+        v128_t ml = wasm_u16x8_load8x8(mid + x), mr = wasm_u16x8_load8x8(mid + x + 2);
+        v128_t dl = wasm_u16x8_load8x8(down + x), dc = wasm_u16x8_load8x8(down + x + 1), dr = wasm_u16x8_load8x8(down + x + 2);
+        v128_t h = wasm_i16x8_add(wasm_i16x8_add(wasm_i16x8_sub(ur, ul), wasm_i16x8_sub(dr, dl)),
+                                  wasm_i16x8_shl(wasm_i16x8_sub(mr, ml), 1));
+        v128_t v = wasm_i16x8_sub(wasm_i16x8_add(wasm_i16x8_add(dl, dr), wasm_i16x8_shl(dc, 1)),
+                                  wasm_i16x8_add(wasm_i16x8_add(ul, ur), wasm_i16x8_shl(uc, 1)));
+        wasm_v128_store(gx + x, h);
+        wasm_v128_store(gy + x, v);
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+#define LOAD8(p) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(p)), zero)
+    for (; x + 8 <= plane_w; x += 8) {
+        __m128i ul = LOAD8(up + x), uc = LOAD8(up + x + 1), ur = LOAD8(up + x + 2);
+        __m128i ml = LOAD8(mid + x), mr = LOAD8(mid + x + 2);
+        __m128i dl = LOAD8(down + x), dc = LOAD8(down + x + 1), dr = LOAD8(down + x + 2);
+        __m128i h = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(ur, ul), _mm_sub_epi16(dr, dl)),
+                                  _mm_slli_epi16(_mm_sub_epi16(mr, ml), 1));
+        __m128i v = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(dl, dr), _mm_slli_epi16(dc, 1)),
+                                  _mm_add_epi16(_mm_add_epi16(ul, ur), _mm_slli_epi16(uc, 1)));
+        _mm_storeu_si128((__m128i *)(gx + x), h);
+        _mm_storeu_si128((__m128i *)(gy + x), v);
+    }
+#undef LOAD8
+#endif
+    for (; x < plane_w; x++) {
+        gx[x] = (int16_t)((up[x + 2] - up[x]) + 2 * (mid[x + 2] - mid[x]) + (down[x + 2] - down[x]));
+        gy[x] = (int16_t)((down[x] + 2 * down[x + 1] + down[x + 2]) - (up[x] + 2 * up[x + 1] + up[x + 2]));
+    }
+}
+
+/* Edge running across a cell with gradient sums gx, gy; bottom / top compare |gy| of its two sample rows */
+static int8_t edge_dir(int gx, int gy, int top, int bottom) {
+    int ax = abs(gx), ay = abs(gy);
+    if (ax + ay < EDGE_THRESHOLD) return EDGE_NONE;
+    // Within 22.5 degrees of an axis (tan 22.5 ~ 0.4) it is straight, otherwise diagonal
+    if (ay * 5 < ax * 2) return EDGE_VERTICAL;
+    if (ax * 5 < ay * 2) return bottom > top ? EDGE_LOW : EDGE_HORIZONTAL;
+    // y grows downwards: a gradient towards the lower right means an edge rising to the right
+    return (gx > 0) == (gy > 0) ? EDGE_RISING : EDGE_FALLING;
+}
+
+void edge_row(const unsigned char *rgba, int width, int height, int cols, int rows, int row,
+              void *scratch, int8_t *dir, uint8_t *luma) {
+    int plane_w = cols * 2, plane_h = rows * 2;
+    EdgeScratch s = scratch_layout(scratch, plane_w);
+
+    for (int x = 0; x < plane_w; x++) s.sx[x] = (int)((long long)x * width / plane_w);
+
+    // Sample rows 2 * row - 1 .. 2 * row + 2, clamped to the image
+    for (int i = 0; i < 4; i++) {
+        int py = row * 2 - 1 + i;
+        if (py < 0) py = 0;
+        if (py >= plane_h) py = plane_h - 1;
+        const unsigned char *src = rgba + (size_t)((long long)py * height / plane_h) * width * 4;
+        uint8_t *dst = s.luma[i] + 1;
+        for (int x = 0; x < plane_w; x++) {
+            const unsigned char *px = src + (size_t)s.sx[x] * 4;
+            dst[x] = (uint8_t)((77 * px[0] + 150 * px[1] + 29 * px[2]) >> 8);
+        }
+        dst[-1] = dst[0];
+        dst[plane_w] = dst[plane_w - 1];
+    }
+
+    sobel_row(s.luma[0], s.luma[1], s.luma[2], plane_w, s.gx[0], s.gy[0]);
+    sobel_row(s.luma[1], s.luma[2], s.luma[3], plane_w, s.gx[1], s.gy[1]);
+
+    for (int c = 0; c < cols; c++) {
+        int x = c * 2;
+        int gx = s.gx[0][x] + s.gx[0][x + 1] + s.gx[1][x] + s.gx[1][x + 1];
+        int gy = s.gy[0][x] + s.gy[0][x + 1] + s.gy[1][x] + s.gy[1][x + 1];
+        int top = abs(s.gy[0][x] + s.gy[0][x + 1]);
+        int bottom = abs(s.gy[1][x] + s.gy[1][x + 1]);
+        dir[c] = edge_dir(gx, gy, top, bottom);
+        luma[c] = (uint8_t)((s.luma[1][x + 1] + s.luma[1][x + 2] + s.luma[2][x + 1] + s.luma[2][x + 2] + 2) >> 2);
+    }
+}
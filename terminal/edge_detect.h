@@ -0,0 +1,41 @@
+#ifndef EDGE_DETECT_H
+#define EDGE_DETECT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Edge directions for mode=edges
+
+Luma is point-sampled at 2 x 2 per cell, and a Sobel gradient is taken at
+every sample. A cell whose summed gradient is strong enough gets the glyph
+of the edge running across it, perpendicular to the gradient; weaker cells
+are left to the brightness ramp. One cell row is handled at a time, from
+the sample rows it covers plus one above and below, so rows can be filled
+in any order.
+*/
+
+#define EDGE_NONE       -1
+enum {
+    EDGE_VERTICAL,      /* | */
+    EDGE_RISING,        /* / */
+    EDGE_HORIZONTAL,    /* - */
+    EDGE_FALLING,       /* \ */
+    EDGE_LOW,           /* _ horizontal, in the lower half of the cell */
+    EDGE_DIRS
+};
+
+/* One glyph per EDGE_* direction, in order */
+#define EDGE_GLYPHS "|/-\\_"
+
+/* Summed |gx| + |gy| of a cell's 4 samples that makes it an edge (a step of about 48 levels) */
+#define EDGE_THRESHOLD  384
+
+/* Scratch bytes edge_row needs for a cols-wide grid */
+size_t edge_scratch_bytes(int cols);
+
+/* EDGE_* (or EDGE_NONE) and mean sample luma of each cell of grid row row */
+void edge_row(const unsigned char *rgba, int width, int height, int cols, int rows, int row,
+              void *scratch, int8_t *dir, uint8_t *luma);
+
+#endif /* EDGE_DETECT_H */
@@ -4,28 +4,13 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <stdbool.h>
+#include "editor_doc.h"
 
-#define MAX_CHARS_PER_LINE   66
-#define INITIAL_LINES_CAPACITY  256
-#define EDITOR_BUFFER_SIZE   (MAX_CHARS_PER_LINE + 16)  // small extra for safety
 #define LINE_NUMBER_PADDING   8
 #define LINE_NUMBER_MARGIN    12
 #define LINE_NUMBER_BG        (SDL_Color){20, 20, 26, 255}
 #define LINE_NUMBER_FG        (SDL_Color){120, 120, 140, 255}
 
-typedef struct {
-    char        c;
-    SDL_Color   fg;
-    SDL_Color   bg;
-    SDL_Texture *texture;       // NULL = not rendered yet (lazy)
-} CharCell;
-
-typedef struct {
-    CharCell    chars[EDITOR_BUFFER_SIZE];
-    int         length;             // real number of characters
-    SDL_Color   bg_color;           // line background (usually same as editor bg)
-} Line;
-
 typedef struct Editor {
 
 	int active;
@@ -40,13 +25,12 @@ typedef struct Editor {
     int line_number_width;
 	int scroll_line;
 	int visible_lines;
+	int scroll_col;         // first column drawn; long lines scroll sideways
 
 
 
     // Document
-    Line       *lines;
-    int         capacity;           // allocated lines
-    int         line_count;         // used lines
+    EditorDoc   doc;
 
     // Cursor (0-based indices)
     int         cursor_line;
@@ -82,11 +66,12 @@ void editor_render(void);
 void editor_insert_char(char c);
 void editor_backspace(void);
 void editor_newline(void);
+void editor_delete(void);
 void editor_move_cursor_left(void);
 void editor_move_cursor_right(void);
 void editor_move_cursor_up(void);
 void editor_move_cursor_down(void);
-void editor_update_textures_line(int line_idx);
+void editor_update_glyphs_lines(int first, int last);
 void clamp_cursor(void);
 
 #endif // EDITOR_H
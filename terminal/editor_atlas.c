@@ -0,0 +1,154 @@
+#include "editor_atlas.h"
+#include "global.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static struct {
+    SDL_Texture *texture;
+    int slot_w;
+    int slot_h;
+    int count;                          /* slots in use; slot 0 is never handed out */
+    BOOL full;
+    uint64_t key[EDITOR_ATLAS_SLOTS];
+    SDL_Rect src[EDITOR_ATLAS_SLOTS];   /* glyph pixels inside the slot */
+    uint16_t table[EDITOR_ATLAS_HASH];  /* slot per hash bucket, 0 = empty */
+
+    SDL_Vertex *verts;                  /* 4 per queued glyph */
+    int *indices;                       /* 6 per queued glyph */
+    int queued;
+    int capacity;
+} atlas;
+
+static uint64_t glyph_key(char c, SDL_Color fg) {
+    return (uint64_t)(unsigned char)c << 32 |
+           (uint32_t)fg.r << 24 | (uint32_t)fg.g << 16 | (uint32_t)fg.b << 8 | fg.a;
+}
+
+static int create_atlas(void) {
+    int minx, maxx, miny, maxy, advance;
+    if (TTF_GlyphMetrics(_sdl.font, 'M', &minx, &maxx, &miny, &maxy, &advance) != 0) return 0;
+
+    // Room for glyphs that overhang their advance
+    atlas.slot_w = advance * 2;
+    atlas.slot_h = TTF_FontHeight(_sdl.font);
+    if (atlas.slot_w <= 0 || atlas.slot_h <= 0) return 0;
+
+    int w = EDITOR_ATLAS_COLS * atlas.slot_w, h = EDITOR_ATLAS_ROWS * atlas.slot_h;
+    atlas.texture = SDL_CreateTexture(_sdl.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, w, h);
+    if (!atlas.texture) return 0;
+    SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+
+    // Slots only cover their glyph, but start from a transparent texture anyway
+    void *clear = calloc((size_t)w * h, 4);
+    if (clear) {
+        SDL_UpdateTexture(atlas.texture, NULL, clear, w * 4);
+        free(clear);
+    }
+    atlas.count = 1;
+    return 1;
+}
+
+/* Rasterize c into the next free slot; returns the slot or 0 */
+static uint16_t fill_slot(char c, SDL_Color fg) {
+    if (atlas.count >= EDITOR_ATLAS_SLOTS) {
+        if (!atlas.full) add_terminal_line("Editor: glyph atlas full, some characters will not be drawn", LINE_FLAG_ERROR);
+        atlas.full = TRUE;
+        return 0;
+    }
+
+    SDL_Surface *surf = TTF_RenderGlyph_Blended(_sdl.font, (unsigned char)c, fg);
+    if (!surf) return 0;
+    if (surf->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        SDL_Surface *conv = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(surf);
+        if (!conv) return 0;
+        surf = conv;
+    }
+
+    int slot = atlas.count++;
+    SDL_Rect *r = &atlas.src[slot];
+    r->x = slot % EDITOR_ATLAS_COLS * atlas.slot_w;
+    r->y = slot / EDITOR_ATLAS_COLS * atlas.slot_h;
+    r->w = surf->w < atlas.slot_w ? surf->w : atlas.slot_w;
+    r->h = surf->h < atlas.slot_h ? surf->h : atlas.slot_h;
+    SDL_UpdateTexture(atlas.texture, r, surf->pixels, surf->pitch);
+    SDL_FreeSurface(surf);
+
+    atlas.key[slot] = glyph_key(c, fg);
+    return (uint16_t)slot;
+}
+
+uint16_t editor_atlas_glyph(char c, SDL_Color fg) {
+    if ((unsigned char)c <= ' ') return 0;
+    if (!atlas.texture && !create_atlas()) return 0;
+
+    uint64_t key = glyph_key(c, fg);
+    unsigned h = (unsigned)((key * 0x9E3779B97F4A7C15ull) >> 40) & (EDITOR_ATLAS_HASH - 1);
+    while (atlas.table[h]) {
+        if (atlas.key[atlas.table[h]] == key) return atlas.table[h];
+        h = (h + 1) & (EDITOR_ATLAS_HASH - 1);
+    }
+
+    uint16_t slot = fill_slot(c, fg);
+    if (slot) atlas.table[h] = slot;
+    return slot;
+}
+
+void editor_atlas_glyph_size(uint16_t glyph, int *w, int *h) {
+    int valid = glyph && glyph < atlas.count;
+    *w = valid ? atlas.src[glyph].w : 0;
+    *h = valid ? atlas.src[glyph].h : 0;
+}
+
+void editor_atlas_queue(uint16_t glyph, const SDL_Rect *dst) {
+    if (!glyph || glyph >= atlas.count) return;
+
+    if (atlas.queued == atlas.capacity) {
+        int cap = atlas.capacity ? atlas.capacity * 2 : 1024;
+        SDL_Vertex *verts = (SDL_Vertex *)realloc(atlas.verts, sizeof(SDL_Vertex) * 4 * cap);
+        if (verts) atlas.verts = verts;
+        int *indices = (int *)realloc(atlas.indices, sizeof(int) * 6 * cap);
+        if (indices) atlas.indices = indices;
+        if (!verts || !indices) return;
+        atlas.capacity = cap;
+    }
+
+    int tex_w = EDITOR_ATLAS_COLS * atlas.slot_w, tex_h = EDITOR_ATLAS_ROWS * atlas.slot_h;
+    const SDL_Rect *src = &atlas.src[glyph];
+    float u0 = (float)src->x / tex_w, u1 = (float)(src->x + src->w) / tex_w;
+    float v0 = (float)src->y / tex_h, v1 = (float)(src->y + src->h) / tex_h;
+    float x0 = (float)dst->x, x1 = (float)(dst->x + dst->w);
+    float y0 = (float)dst->y, y1 = (float)(dst->y + dst->h);
+
+    SDL_Vertex *v = atlas.verts + atlas.queued * 4;
+    SDL_Color white = {255, 255, 255, 255};
+    v[0] = (SDL_Vertex){{x0, y0}, white, {u0, v0}};
+    v[1] = (SDL_Vertex){{x1, y0}, white, {u1, v0}};
+    v[2] = (SDL_Vertex){{x1, y1}, white, {u1, v1}};
+    v[3] = (SDL_Vertex){{x0, y1}, white, {u0, v1}};
+
+    int base = atlas.queued * 4, *idx = atlas.indices + atlas.queued * 6;
+    idx[0] = base;
+    idx[1] = base + 1;
+    idx[2] = base + 2;
+    idx[3] = base;
+    idx[4] = base + 2;
+    idx[5] = base + 3;
+    atlas.queued++;
+}
+
+void editor_atlas_flush(void) {
+    if (atlas.queued > 0) {
+        SDL_RenderGeometry(_sdl.renderer, atlas.texture, atlas.verts, atlas.queued * 4,
+                           atlas.indices, atlas.queued * 6);
+    }
+    atlas.queued = 0;
+}
+
+void editor_atlas_free(void) {
+    if (atlas.texture) SDL_DestroyTexture(atlas.texture);
+    free(atlas.verts);
+    free(atlas.indices);
+    memset(&atlas, 0, sizeof(atlas));
+}
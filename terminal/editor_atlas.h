@@ -0,0 +1,35 @@
+#ifndef EDITOR_ATLAS_H
+#define EDITOR_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+/*
+Glyph atlas for the editor
+
+Every (character, foreground color) pair is rasterized once into a slot of a
+single texture; cells keep only the slot index. A frame of text is one
+SDL_RenderGeometry call over the atlas, so edits never create or destroy
+textures and the texture count does not depend on the document.
+*/
+
+#define EDITOR_ATLAS_COLS    32
+#define EDITOR_ATLAS_ROWS    16
+#define EDITOR_ATLAS_SLOTS   (EDITOR_ATLAS_COLS * EDITOR_ATLAS_ROWS)
+#define EDITOR_ATLAS_HASH    1024    /* power of two, about twice the slots */
+
+/* Slot of c in color fg, rasterized on first use; 0 = nothing to draw (blank or atlas full) */
+uint16_t editor_atlas_glyph(char c, SDL_Color fg);
+
+/* Size the glyph was rasterized at; 0 x 0 for slot 0 */
+void editor_atlas_glyph_size(uint16_t glyph, int *w, int *h);
+
+/* Queue glyph stretched over dst; drawn by editor_atlas_flush */
+void editor_atlas_queue(uint16_t glyph, const SDL_Rect *dst);
+
+/* Draw the queued glyphs in one call and empty the queue */
+void editor_atlas_flush(void);
+
+void editor_atlas_free(void);
+
+#endif /* EDITOR_ATLAS_H */
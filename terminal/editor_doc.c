@@ -0,0 +1,249 @@
+#include "editor_doc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DOC_INITIAL_CELLS  4096
+#define DOC_INITIAL_LINES  256
+
+/* ---------- line index ---------- */
+
+static uint32_t next_prio(EditorDoc *doc) {
+    // xorshift32; any nonzero seed works
+    uint32_t x = doc->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return doc->seed = x;
+}
+
+static void update(DocLine *n, int i) {
+    DocLine *d = &n[i];
+    d->count = n[d->left].count + n[d->right].count + 1;
+    d->sum = n[d->left].sum + n[d->right].sum + d->len;
+}
+
+static int new_node(EditorDoc *doc, size_t len) {
+    int i = doc->free_node;
+    if (i) {
+        doc->free_node = doc->nodes[i].left;
+    } else {
+        if (doc->next_node == doc->node_cap) {
+            int cap = doc->node_cap * 2;
+            DocLine *nodes = (DocLine *)realloc(doc->nodes, sizeof(DocLine) * cap);
+            if (!nodes) return 0;
+            doc->nodes = nodes;
+            doc->node_cap = cap;
+        }
+        i = doc->next_node++;
+    }
+    DocLine *d = &doc->nodes[i];
+    d->left = d->right = 0;
+    d->prio = next_prio(doc);
+    d->len = len;
+    d->state = 0;
+    update(doc->nodes, i);
+    return i;
+}
+
+static int merge(DocLine *n, int a, int b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (n[a].prio > n[b].prio) {
+        n[a].right = merge(n, n[a].right, b);
+        update(n, a);
+        return a;
+    }
+    n[b].left = merge(n, a, n[b].left);
+    update(n, b);
+    return b;
+}
+
+/* First k lines of t into *a, the rest into *b */
+static void split(DocLine *n, int t, int k, int *a, int *b) {
+    if (!t) {
+        *a = *b = 0;
+        return;
+    }
+    if (n[n[t].left].count < k) {
+        split(n, n[t].right, k - n[n[t].left].count - 1, &n[t].right, b);
+        *a = t;
+    } else {
+        split(n, n[t].left, k, a, &n[t].left);
+        *b = t;
+    }
+    update(n, t);
+}
+
+/* Node of line k, and the position its first cell is at */
+static int find_line(const EditorDoc *doc, int k, size_t *start) {
+    const DocLine *n = doc->nodes;
+    size_t off = 0;
+    int t = doc->root;
+    while (t) {
+        int left = n[n[t].left].count;
+        if (k < left) {
+            t = n[t].left;
+        } else if (k == left) {
+            off += n[n[t].left].sum;
+            break;
+        } else {
+            off += n[n[t].left].sum + n[t].len;
+            k -= left + 1;
+            t = n[t].right;
+        }
+    }
+    if (start) *start = off;
+    return t;
+}
+
+/* Add delta to the length of line k, fixing the sums on the way down */
+static void add_len(EditorDoc *doc, int k, long delta) {
+    DocLine *n = doc->nodes;
+    int t = doc->root;
+    while (t) {
+        n[t].sum += delta;
+        int left = n[n[t].left].count;
+        if (k < left) {
+            t = n[t].left;
+        } else if (k == left) {
+            n[t].len += delta;
+            return;
+        } else {
+            k -= left + 1;
+            t = n[t].right;
+        }
+    }
+}
+
+static int insert_line(EditorDoc *doc, int k, size_t len) {
+    int node = new_node(doc, len);
+    if (!node) return 0;
+    int a, b;
+    split(doc->nodes, doc->root, k, &a, &b);
+    doc->root = merge(doc->nodes, merge(doc->nodes, a, node), b);
+    return 1;
+}
+
+static void erase_line(EditorDoc *doc, int k) {
+    int a, mid, b;
+    split(doc->nodes, doc->root, k, &a, &b);
+    split(doc->nodes, b, 1, &mid, &b);
+    doc->nodes[mid].left = doc->free_node;
+    doc->free_node = mid;
+    doc->root = merge(doc->nodes, a, b);
+}
+
+/* ---------- gap buffer ---------- */
+
+static void move_gap(EditorDoc *doc, size_t pos) {
+    size_t gap = doc->gap_end - doc->gap_start;
+    if (pos < doc->gap_start) {
+        size_t n = doc->gap_start - pos;
+        memmove(doc->cells + pos + gap, doc->cells + pos, n * sizeof(CharCell));
+    } else if (pos > doc->gap_start) {
+        size_t n = pos - doc->gap_start;
+        memmove(doc->cells + doc->gap_start, doc->cells + doc->gap_end, n * sizeof(CharCell));
+    }
+    doc->gap_start = pos;
+    doc->gap_end = pos + gap;
+}
+
+static int grow_gap(EditorDoc *doc) {
+    size_t cap = doc->cap * 2, tail = doc->cap - doc->gap_end;
+    CharCell *cells = (CharCell *)realloc(doc->cells, cap * sizeof(CharCell));
+    if (!cells) return 0;
+    memmove(cells + cap - tail, cells + doc->gap_end, tail * sizeof(CharCell));
+    doc->cells = cells;
+    doc->gap_end = cap - tail;
+    doc->cap = cap;
+    return 1;
+}
+
+/* ---------- public ---------- */
+
+int editor_doc_init(EditorDoc *doc) {
+    memset(doc, 0, sizeof(*doc));
+    doc->cells = (CharCell *)malloc(DOC_INITIAL_CELLS * sizeof(CharCell));
+    doc->nodes = (DocLine *)calloc(DOC_INITIAL_LINES, sizeof(DocLine));
+    if (!doc->cells || !doc->nodes) {
+        editor_doc_free(doc);
+        return 0;
+    }
+    doc->cap = DOC_INITIAL_CELLS;
+    doc->gap_end = doc->cap;
+    doc->node_cap = DOC_INITIAL_LINES;
+    doc->next_node = 1;
+    doc->seed = 0x9E3779B9u;
+    doc->root = new_node(doc, 0);
+    return 1;
+}
+
+void editor_doc_free(EditorDoc *doc) {
+    free(doc->cells);
+    free(doc->nodes);
+    memset(doc, 0, sizeof(*doc));
+}
+
+int editor_doc_lines(const EditorDoc *doc) {
+    return doc->nodes ? doc->nodes[doc->root].count : 0;
+}
+
+int editor_doc_line_length(const EditorDoc *doc, int line) {
+    int t = find_line(doc, line, NULL);
+    if (!t) return 0;
+    int newline = line < editor_doc_lines(doc) - 1;
+    return (int)(doc->nodes[t].len - newline);
+}
+
+size_t editor_doc_line_start(const EditorDoc *doc, int line) {
+    size_t start = 0;
+    find_line(doc, line, &start);
+    return start;
+}
+
+int editor_doc_line_state(const EditorDoc *doc, int line) {
+    return doc->nodes[find_line(doc, line, NULL)].state;
+}
+
+void editor_doc_set_line_state(EditorDoc *doc, int line, int state) {
+    int t = find_line(doc, line, NULL);
+    if (t) doc->nodes[t].state = (uint8_t)state;
+}
+
+int editor_doc_insert(EditorDoc *doc, int line, int col, char c) {
+    size_t start;
+    int t = find_line(doc, line, &start);
+    if (!t) return 0;
+    if (doc->gap_start == doc->gap_end && !grow_gap(doc)) return 0;
+
+    size_t len = doc->nodes[t].len;
+    if (c == '\n' && !insert_line(doc, line + 1, len - col)) return 0;
+
+    move_gap(doc, start + col);
+    CharCell *cell = &doc->cells[doc->gap_start++];
+    memset(cell, 0, sizeof(*cell));
+    cell->c = c;
+
+    if (c == '\n') add_len(doc, line, (long)col + 1 - (long)len);
+    else add_len(doc, line, 1);
+    return 1;
+}
+
+void editor_doc_erase(EditorDoc *doc, int line, int col) {
+    size_t start;
+    int t = find_line(doc, line, &start);
+    if (!t || col < 0 || (size_t)col >= doc->nodes[t].len) return;
+
+    move_gap(doc, start + col);
+    char c = doc->cells[doc->gap_end++].c;
+
+    if (c == '\n') {
+        // The next line's cells now end this one
+        int next = find_line(doc, line + 1, NULL);
+        long joined = (long)doc->nodes[next].len;
+        erase_line(doc, line + 1);
+        add_len(doc, line, joined - 1);
+    } else {
+        add_len(doc, line, -1);
+    }
+}
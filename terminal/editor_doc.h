@@ -0,0 +1,76 @@
+#ifndef EDITOR_DOC_H
+#define EDITOR_DOC_H
+
+#include <SDL2/SDL.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Editor document: one gap buffer of cells plus a line index
+
+Cells of the whole document, newlines included, live in a single gap buffer;
+typing next to the previous edit costs O(1), a jump moves the gap once. The
+line index is an implicit treap (ordered by position, balanced by random
+priorities) of line lengths with subtree sums, so finding where a line starts,
+splitting a line and joining two lines are all O(log lines). Neither the
+document nor a line has a size limit.
+*/
+
+typedef struct {
+    char        c;
+    SDL_Color   fg;
+    uint16_t    glyph;          // editor atlas slot, 0 = nothing to draw
+} CharCell;
+
+typedef struct {
+    int         left;           // 0 = none; node 0 is never used
+    int         right;
+    uint32_t    prio;
+    int         count;          // lines in this subtree
+    size_t      len;            // cells of this line, its newline included
+    size_t      sum;            // cells in this subtree
+    uint8_t     state;          // owner's state at the start of this line
+} DocLine;
+
+typedef struct {
+    CharCell   *cells;
+    size_t      cap;
+    size_t      gap_start;
+    size_t      gap_end;
+
+    DocLine    *nodes;
+    int         node_cap;
+    int         free_node;      // chained through left
+    int         next_node;
+    int         root;
+    uint32_t    seed;
+} EditorDoc;
+
+/* One empty line; returns 0 when out of memory */
+int editor_doc_init(EditorDoc *doc);
+void editor_doc_free(EditorDoc *doc);
+
+int editor_doc_lines(const EditorDoc *doc);
+
+/* Length of line without its newline */
+int editor_doc_line_length(const EditorDoc *doc, int line);
+
+/* Document position of the first cell of line */
+size_t editor_doc_line_start(const EditorDoc *doc, int line);
+
+/* State kept with each line for the highlighter; lines start at 0 */
+int editor_doc_line_state(const EditorDoc *doc, int line);
+void editor_doc_set_line_state(EditorDoc *doc, int line, int state);
+
+/* Cell at document position pos (below the document length) */
+static inline CharCell *editor_doc_cell(const EditorDoc *doc, size_t pos) {
+    return &doc->cells[pos < doc->gap_start ? pos : pos + (doc->gap_end - doc->gap_start)];
+}
+
+/* Insert c before column col of line; '\n' splits the line. Returns 0 when out of memory */
+int editor_doc_insert(EditorDoc *doc, int line, int col, char c);
+
+/* Remove the cell at column col of line; at the end of a line the next one is joined */
+void editor_doc_erase(EditorDoc *doc, int line, int col);
+
+#endif /* EDITOR_DOC_H */
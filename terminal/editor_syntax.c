@@ -0,0 +1,204 @@
+#include "editor_syntax.h"
+#include "editor_atlas.h"
+
+#include <ctype.h>
+#include <string.h>
+
+typedef enum {
+    TOKEN_TEXT,
+    TOKEN_KEYWORD,
+    TOKEN_PREPROC,
+    TOKEN_COMMENT,
+    TOKEN_STRING,
+    TOKEN_NUMBER
+} TokenClass;
+
+static const SDL_Color token_colors[] = {
+    [TOKEN_TEXT]    = {235, 235, 240, 255},
+    [TOKEN_KEYWORD] = { 86, 156, 214, 255},  // blue-ish
+    [TOKEN_PREPROC] = {180, 140, 255, 255},  // purple-ish
+    [TOKEN_COMMENT] = {106, 153,  85, 255},  // green-ish
+    [TOKEN_STRING]  = {206, 145, 120, 255},  // orange-ish
+    [TOKEN_NUMBER]  = {181, 206, 168, 255},  // pale green
+};
+
+/*
+ Collision-free over the keywords below; generated offline by trying small
+ multipliers until every keyword landed in its own bucket.
+*/
+#define KEYWORD_MAX_LEN  14
+
+static unsigned keyword_hash(const char *w, int len) {
+    return (unsigned)(len + (unsigned char)w[0] * 16 + (unsigned char)w[len - 1] * 9 +
+                      (unsigned char)w[len / 2]) & 255;
+}
+
+static const char *const keywords[256] = {
+    [20] = "alignof", [21] = "int", [37] = "static", [40] = "signed", [41] = "_Decimal32",
+    [45] = "_Thread_local", [46] = "continue", [48] = "_Bool", [49] = "sizeof", [52] = "case",
+    [53] = "double", [59] = "_Decimal64", [60] = "_Noreturn", [65] = "typeof", [66] = "typedef",
+    [67] = "unsigned", [70] = "true", [77] = "break", [81] = "void", [82] = "switch",
+    [84] = "else", [85] = "nullptr", [94] = "false", [95] = "bool", [96] = "_Decimal128",
+    [105] = "volatile", [106] = "_Alignas", [107] = "while", [111] = "auto",
+    [113] = "_Static_assert", [119] = "thread_local", [120] = "typeof_unqual", [121] = "return",
+    [127] = "_BitInt", [137] = "alignas", [140] = "inline", [142] = "if", [151] = "char",
+    [152] = "do", [153] = "extern", [156] = "union", [157] = "register", [158] = "enum",
+    [160] = "_Complex", [164] = "_Imaginary", [174] = "restrict", [175] = "constexpr",
+    [176] = "static_assert", [183] = "const", [184] = "short", [188] = "default",
+    [191] = "struct", [207] = "goto", [209] = "long", [212] = "for", [216] = "_Generic",
+    [225] = "_Atomic", [232] = "float", [245] = "_Alignof",
+};
+
+static int is_keyword(const char *w, int len) {
+    if (len > KEYWORD_MAX_LEN) return 0;
+    const char *k = keywords[keyword_hash(w, len)];
+    return k && (int)strlen(k) == len && memcmp(k, w, len) == 0;
+}
+
+/* One line of the document being lexed */
+typedef struct {
+    EditorDoc *doc;
+    size_t start;
+    int len;
+} LexLine;
+
+static char lex_at(const LexLine *l, int i) {
+    return i < l->len ? editor_doc_cell(l->doc, l->start + i)->c : 0;
+}
+
+static void paint(const LexLine *l, int from, int to, TokenClass token) {
+    SDL_Color fg = token_colors[token];
+    for (int i = from; i < to; i++) {
+        CharCell *cell = editor_doc_cell(l->doc, l->start + i);
+        cell->fg = fg;
+        cell->glyph = editor_atlas_glyph(cell->c, fg);
+    }
+}
+
+/* Index just past the end of a block comment open at i, or -1 if it runs on */
+static int comment_end(const LexLine *l, int i) {
+    for (; i + 1 < l->len; i++) {
+        if (lex_at(l, i) == '*' && lex_at(l, i + 1) == '/') return i + 2;
+    }
+    return -1;
+}
+
+/* Index after the q closing a literal that is open at i; *continued when a trailing backslash carries it on */
+static int literal_end(const LexLine *l, int i, char q, int *continued) {
+    while (i < l->len) {
+        char c = lex_at(l, i++);
+        if (c == '\\' && q != '>') {
+            if (i == l->len) *continued = 1;
+            i++;
+        } else if (c == q) {
+            return i;
+        }
+    }
+    return l->len;
+}
+
+static int is_ident(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+/* Color one line lexed from state; returns the state the next line starts in */
+static SyntaxState lex_line(EditorDoc *doc, int line, SyntaxState state) {
+    LexLine l = { doc, editor_doc_line_start(doc, line), editor_doc_line_length(doc, line) };
+    int i = 0;
+
+    if (state == SYNTAX_COMMENT) {
+        int end = comment_end(&l, 0);
+        if (end < 0) {
+            paint(&l, 0, l.len, TOKEN_COMMENT);
+            return SYNTAX_COMMENT;
+        }
+        paint(&l, 0, end, TOKEN_COMMENT);
+        i = end;
+    } else if (state == SYNTAX_STRING) {
+        int continued = 0;
+        i = literal_end(&l, 0, '"', &continued);
+        paint(&l, 0, i, TOKEN_STRING);
+        if (continued) return SYNTAX_STRING;
+    }
+
+    int only_space = i == 0;    // a '#' here starts a directive
+    int after_hash = 0;         // the next word is the directive name
+    int include = 0;            // <...> is a header name
+
+    while (i < l.len) {
+        char c = lex_at(&l, i), next = lex_at(&l, i + 1);
+        int end = i + 1;
+        TokenClass token = TOKEN_TEXT;
+
+        if (c == '/' && next == '/') {
+            paint(&l, i, l.len, TOKEN_COMMENT);
+            return SYNTAX_NORMAL;
+        } else if (c == '/' && next == '*') {
+            end = comment_end(&l, i + 2);
+            if (end < 0) {
+                paint(&l, i, l.len, TOKEN_COMMENT);
+                return SYNTAX_COMMENT;
+            }
+            token = TOKEN_COMMENT;
+        } else if (c == '"' || c == '\'' || (include && c == '<')) {
+            int continued = 0;
+            end = literal_end(&l, i + 1, c == '<' ? '>' : c, &continued);
+            paint(&l, i, end, TOKEN_STRING);
+            if (continued && c == '"') return SYNTAX_STRING;
+            i = end;
+            continue;
+        } else if (isdigit((unsigned char)c) || (c == '.' && isdigit((unsigned char)next))) {
+            char prev = c;
+            while (end < l.len) {
+                char d = lex_at(&l, end);
+                int exponent_sign = (d == '+' || d == '-') && strchr("eEpP", prev);
+                if (!is_ident(d) && d != '.' && !exponent_sign) break;
+                prev = d;
+                end++;
+            }
+            token = TOKEN_NUMBER;
+        } else if (is_ident(c)) {
+            char word[KEYWORD_MAX_LEN + 1];
+            int n = 0;
+            for (end = i; end < l.len && is_ident(lex_at(&l, end)); end++) {
+                if (n <= KEYWORD_MAX_LEN) word[n++] = lex_at(&l, end);
+            }
+            int len = end - i;
+            if (after_hash) {
+                token = TOKEN_PREPROC;
+                include = len == 7 && memcmp(word, "include", 7) == 0;
+            } else if (is_keyword(word, len)) {
+                token = TOKEN_KEYWORD;
+            }
+            after_hash = 0;
+        } else if (c == '#' && only_space) {
+            token = TOKEN_PREPROC;
+            after_hash = 1;
+        }
+
+        if (!isspace((unsigned char)c)) only_space = 0;
+        paint(&l, i, end, token);
+        i = end;
+    }
+    return SYNTAX_NORMAL;
+}
+
+int editor_syntax_update(EditorDoc *doc, int first, int last) {
+    int lines = editor_doc_lines(doc);
+    if (first < 0) first = 0;
+    if (first >= lines) return 0;
+
+    SyntaxState state = first == 0 ? SYNTAX_NORMAL : (SyntaxState)editor_doc_line_state(doc, first);
+    int lexed = 0;
+    for (int line = first; line < lines; line++) {
+        SyntaxState exit = lex_line(doc, line, state);
+        lexed++;
+        if (line + 1 == lines) break;
+
+        // Past the edit the rest is already right once the entry state agrees
+        if (line >= last && editor_doc_line_state(doc, line + 1) == (int)exit) break;
+        editor_doc_set_line_state(doc, line + 1, exit);
+        state = exit;
+    }
+    return lexed;
+}
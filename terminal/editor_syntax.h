@@ -0,0 +1,26 @@
+#ifndef EDITOR_SYNTAX_H
+#define EDITOR_SYNTAX_H
+
+#include "editor_doc.h"
+
+/*
+Incremental C highlighting for the editor
+
+A small lexer colors keywords (a perfect hash over the C23 keyword set),
+preprocessor directives, strings, chars, numbers and both comment styles.
+What it needs from the previous line (inside a block comment, or a string
+continued with a backslash) is stored as the entry state of each line, so
+an edit re-lexes from the changed line only until the state it hands to the
+next line matches what that line already had.
+*/
+
+typedef enum {
+    SYNTAX_NORMAL = 0,      /* what new lines start with */
+    SYNTAX_COMMENT,         /* inside a block comment */
+    SYNTAX_STRING           /* string literal continued by a trailing backslash */
+} SyntaxState;
+
+/* Recolor lines first..last, then following lines until the state converges; returns the lines lexed */
+int editor_syntax_update(EditorDoc *doc, int first, int last);
+
+#endif /* EDITOR_SYNTAX_H */
@@ -42,9 +42,6 @@
 #define INPUT_MAX_CHARS       256
 #define INPUT_MAX_VISIBLE     (INPUT_MAX_CHARS - 1)
 
-// FILES / EXPORT
-#define MAX_PNG_SIZE  (50 * 1024 * 1024)
-
 // Extension
 #define PAGE_EXT ".html"
 #define PAGE_EXT_LEN 5
@@ -140,7 +137,11 @@ typedef enum {
     LINE_FLAG_BOLD       = 1 << 8,    
     LINE_FLAG_ITALIC     = 1 << 9,     
     LINE_FLAG_UNDERLINE  = 1 << 10,   
-    LINE_FLAG_STRIKE     = 1 << 11 
+    LINE_FLAG_STRIKE     = 1 << 11,
+
+    LINE_FLAG_ANIMATED   = 1 << 12,    // texture owned by the GIF player, not the line
+    LINE_FLAG_REFINING   = 1 << 13,    // coarse preview, swapped for the full grid when ready
+    LINE_FLAG_VIEWING    = 1 << 14     // re-rendered in place by the zoom / pan viewer
 
 } TerminalLineFlags;
 
@@ -241,8 +242,8 @@ int is_at_bottom(void);
 int terminal_content_height(void);
 void clear_terminal(void);
 void add_terminal_line(const char *text, TerminalLineFlags flags);
+TerminalLine *add_terminal_texture_line(SDL_Texture *texture, int w, int h, TerminalLineFlags flags);
 void submit_input(void);
-void parse_color(const char *name, uint8_t *r, uint8_t *g, uint8_t *b);
 void update_max_scroll(void);
 void add_log( const char *text, LogType type);
 #endif
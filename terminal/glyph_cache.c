@@ -0,0 +1,105 @@
+#include "glyph_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void copy_coverage(SDL_Surface *surf, uint8_t *dst, int cell_w, int cell_h) {
+    const SDL_PixelFormat *fmt = surf->format;
+    int w = surf->w < cell_w ? surf->w : cell_w;
+    int h = surf->h < cell_h ? surf->h : cell_h;
+
+    for (int y = 0; y < h; y++) {
+        const Uint32 *src = (const Uint32 *)((const Uint8 *)surf->pixels + (size_t)y * surf->pitch);
+        for (int x = 0; x < w; x++) {
+            dst[y * cell_w + x] = (uint8_t)((src[x] & fmt->Amask) >> fmt->Ashift);
+        }
+    }
+}
+
+int glyph_set_build(GlyphSet *set, TTF_Font *font, const char *const *glyphs, int count) {
+    if (!set || !font || count <= 0) return 0;
+    memset(set, 0, sizeof(*set));
+
+    // Monospace cell, same metrics as a rendered text row
+    TTF_SizeUTF8(font, "A", &set->cell_w, NULL);
+    set->cell_h = TTF_FontLineSkip(font);
+    if (set->cell_w <= 0 || set->cell_h <= 0) return 0;
+
+    size_t cell_px = (size_t)set->cell_w * set->cell_h;
+    set->coverage = (uint8_t *)calloc((size_t)count, cell_px);
+    if (!set->coverage) return 0;
+    set->count = count;
+
+    SDL_Color white = {255, 255, 255, 255};
+    for (int i = 0; i < count; i++) {
+        if (!glyphs[i] || !glyphs[i][0] || strcmp(glyphs[i], " ") == 0) continue;
+
+        SDL_Surface *surf = TTF_RenderUTF8_Blended(font, glyphs[i], white);
+        if (!surf) continue;
+
+        if (SDL_LockSurface(surf) == 0) {
+            copy_coverage(surf, set->coverage + i * cell_px, set->cell_w, set->cell_h);
+            SDL_UnlockSurface(surf);
+        }
+        SDL_FreeSurface(surf);
+    }
+    return 1;
+}
+
+void glyph_set_free(GlyphSet *set) {
+    if (!set) return;
+    free(set->coverage);
+    memset(set, 0, sizeof(*set));
+}
+
+int glyph_tiles_build(GlyphTiles *tiles, TTF_Font *font, const char *const *glyphs, int count, SDL_Color color) {
+    if (!tiles) return 0;
+    memset(tiles, 0, sizeof(*tiles));
+
+    GlyphSet set;
+    if (!glyph_set_build(&set, font, glyphs, count)) return 0;
+
+    size_t px = (size_t)set.count * set.cell_w * set.cell_h;
+    tiles->rgba = (uint8_t *)malloc(px * 4);
+    if (!tiles->rgba) {
+        glyph_set_free(&set);
+        return 0;
+    }
+    for (size_t i = 0; i < px; i++) {
+        uint8_t *dst = tiles->rgba + i * 4;
+        dst[0] = color.r;
+        dst[1] = color.g;
+        dst[2] = color.b;
+        dst[3] = set.coverage[i];
+    }
+
+    tiles->cell_w = set.cell_w;
+    tiles->cell_h = set.cell_h;
+    tiles->count = set.count;
+    glyph_set_free(&set);
+    return 1;
+}
+
+void glyph_tiles_free(GlyphTiles *tiles) {
+    if (!tiles) return;
+    free(tiles->rgba);
+    memset(tiles, 0, sizeof(*tiles));
+}
+
+void glyph_stamp_rows(void *ctx, int begin, int end) {
+    const GlyphStamp *job = (const GlyphStamp *)ctx;
+    size_t tile_row = (size_t)job->cell_w * job->bpp;
+    size_t tile_bytes = tile_row * job->cell_h;
+
+    for (int row = begin; row < end; row++) {
+        const uint8_t *line = job->cells + (size_t)row * job->cols;
+        uint8_t *dst_row = job->pixels + (size_t)row * job->cell_h * job->pitch;
+
+        for (int col = 0; col < job->cols; col++) {
+            const uint8_t *tile = job->tiles + line[col] * tile_bytes;
+            uint8_t *dst = dst_row + col * tile_row;
+            for (int y = 0; y < job->cell_h; y++) {
+                memcpy(dst + (size_t)y * job->pitch, tile + y * tile_row, tile_row);
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdint.h>
+#include "sdl.h"
+
+/* Glyphs rasterized once into fixed-size coverage bitmaps (one per cell) */
+typedef struct {
+    int cell_w;
+    int cell_h;
+    int count;
+    uint8_t *coverage;     /* count * cell_w * cell_h alpha values, row-major */
+} GlyphSet;
+
+/* Rasterize each UTF-8 glyph with font; returns 1 on success */
+int glyph_set_build(GlyphSet *set, TTF_Font *font, const char *const *glyphs, int count);
+void glyph_set_free(GlyphSet *set);
+
+static inline const uint8_t *glyph_set_bitmap(const GlyphSet *set, int idx) {
+    return set->coverage + (size_t)idx * set->cell_w * set->cell_h;
+}
+
+/* Glyphs in one color over a transparent background, ready to stamp into RGBA */
+typedef struct {
+    int cell_w;
+    int cell_h;
+    int count;
+    uint8_t *rgba;          /* count * cell_w * cell_h pixels */
+} GlyphTiles;
+
+int glyph_tiles_build(GlyphTiles *tiles, TTF_Font *font, const char *const *glyphs, int count, SDL_Color color);
+void glyph_tiles_free(GlyphTiles *tiles);
+
+/* One band of cell rows stamped from pre-blended glyph tiles */
+typedef struct {
+    const uint8_t *cells;   /* rows * cols tile indices */
+    int cols;
+    int cell_w;
+    int cell_h;
+    int bpp;                /* bytes per tile pixel */
+    const uint8_t *tiles;   /* cell_w * cell_h * bpp bytes per tile */
+    uint8_t *pixels;
+    int pitch;
+} GlyphStamp;
+
+/* band_func over cell rows: copies each cell's tile into pixels */
+void glyph_stamp_rows(void *ctx, int begin, int end);
+
+#endif /* GLYPH_CACHE_H */
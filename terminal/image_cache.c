@@ -0,0 +1,136 @@
+#include "image_cache.h"
+#include "stb_image.h"
+#include <stdlib.h>
+#include <string.h>
+
+static CachedImage slots[IMAGE_CACHE_SLOTS];
+static size_t cache_bytes = 0;
+static uint32_t use_clock = 0;
+
+static size_t entry_bytes(const CachedImage *e) {
+    return (size_t)e->width * e->height * 4 + (size_t)e->source_size;
+}
+
+static void drop(CachedImage *e) {
+    if (!e->pixels) return;
+    cache_bytes -= entry_bytes(e);
+    stbi_image_free(e->pixels);
+    free(e->source);
+    memset(e, 0, sizeof(*e));
+}
+
+static CachedImage *least_recent(void) {
+    CachedImage *oldest = NULL;
+    for (int i = 0; i < IMAGE_CACHE_SLOTS; i++) {
+        if (slots[i].pixels && !slots[i].pins && (!oldest || slots[i].last_used < oldest->last_used)) oldest = &slots[i];
+    }
+    return oldest;
+}
+
+/* FNV-1a */
+uint64_t image_cache_key(const char *url) {
+    uint64_t h = 1469598103934665603ULL;
+    for (const unsigned char *p = (const unsigned char *)url; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+const CachedImage *image_cache_get(uint64_t key) {
+    for (int i = 0; i < IMAGE_CACHE_SLOTS; i++) {
+        if (slots[i].pixels && slots[i].key == key) {
+            slots[i].last_used = ++use_clock;
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+const CachedImage *image_cache_put(uint64_t key, unsigned char *pixels, int width, int height,
+                                   const unsigned char *source, int source_size, int scale, int gray) {
+    if (!pixels) return NULL;
+
+    // Copied first: source may belong to the entry replaced below
+    CachedImage e = { .key = key, .width = width, .height = height, .pixels = pixels, .scale = scale,
+                      .gray = gray };
+    if (source && source_size > 0) {
+        e.source = (unsigned char *)image_cache_alloc(source_size);
+        if (e.source) {
+            memcpy(e.source, source, source_size);
+            e.source_size = source_size;
+        }
+    }
+
+    // Same URL fetched again: the new copy wins (a pinned old copy lives on until unpinned)
+    for (int i = 0; i < IMAGE_CACHE_SLOTS; i++) {
+        if (slots[i].pixels && slots[i].key == key) {
+            if (slots[i].pins) slots[i].key = 0;
+            else drop(&slots[i]);
+        }
+    }
+
+    // Evict until it fits, but never refuse an image for being large on its own
+    size_t need = entry_bytes(&e);
+    CachedImage *slot = NULL;
+    for (;;) {
+        for (int i = 0; i < IMAGE_CACHE_SLOTS && !slot; i++) {
+            if (!slots[i].pixels) slot = &slots[i];
+        }
+        if (slot && cache_bytes + need <= IMAGE_CACHE_BUDGET) break;
+        CachedImage *victim = least_recent();
+        if (!victim) break;
+        drop(victim);
+    }
+    if (!slot) {
+        stbi_image_free(pixels);
+        free(e.source);
+        return NULL;
+    }
+
+    e.last_used = ++use_clock;
+    *slot = e;
+    cache_bytes += need;
+    return slot;
+}
+
+void image_cache_flush(void) {
+    for (int i = 0; i < IMAGE_CACHE_SLOTS; i++) {
+        if (!slots[i].pins) drop(&slots[i]);
+    }
+}
+
+void image_cache_trim(size_t bytes) {
+    CachedImage *victim;
+    while (cache_bytes > bytes && (victim = least_recent()) != NULL) drop(victim);
+}
+
+void image_cache_pin(const CachedImage *img) {
+    if (img) ((CachedImage *)img)->pins++;
+}
+
+void image_cache_unpin(const CachedImage *img) {
+    if (!img || img->pins == 0) return;
+    CachedImage *e = (CachedImage *)img;
+    // Replaced while pinned: nothing can look it up any more
+    if (--e->pins == 0 && e->key == 0) drop(e);
+}
+
+void *image_cache_alloc(size_t size) {
+    void *p = malloc(size);
+    if (!p && cache_bytes > 0) {
+        image_cache_flush();
+        p = malloc(size);
+    }
+    return p;
+}
+
+size_t image_cache_bytes(void) {
+    return cache_bytes;
+}
+
+int image_cache_count(void) {
+    int n = 0;
+    for (int i = 0; i < IMAGE_CACHE_SLOTS; i++) n += slots[i].pixels != NULL;
+    return n;
+}
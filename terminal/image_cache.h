@@ -0,0 +1,65 @@
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Decoded image cache
+
+Images fetched by to_ascii are kept decoded (RGBA) and keyed by a hash of
+their URL, so re-running to_ascii on the same URL with other options skips
+the fetch, the base64 round trip and the decode. JPEGs may be decoded at a
+reduced scale; their encoded bytes are kept to decode again when a wider
+grid needs more detail. Least recently used images
+are evicted past IMAGE_CACHE_BUDGET bytes or IMAGE_CACHE_SLOTS images; a
+single larger image is still kept on its own.
+*/
+
+#define IMAGE_CACHE_BUDGET  (64 * 1024 * 1024)
+#define IMAGE_CACHE_SLOTS   8
+
+typedef struct {
+    uint64_t key;
+    int width;
+    int height;
+    unsigned char *pixels;      /* RGBA, first frame for GIFs */
+    unsigned char *source;      /* encoded bytes of GIFs (playback) and scaled JPEGs */
+    int source_size;
+    int scale;                  /* pixels are 1/scale of the full size */
+    int gray;                   /* luma only (JPEG decoded without chroma) */
+    uint32_t last_used;
+    int pins;                   /* pinned entries are never evicted or flushed */
+} CachedImage;
+
+uint64_t image_cache_key(const char *url);
+
+/* Entry for key, now the most recently used; NULL on a miss */
+const CachedImage *image_cache_get(uint64_t key);
+
+/*
+ Store a decoded image (pixels from malloc or stbi, owned by the cache from
+ now on) and optionally a copy of its encoded bytes, which may be those of
+ the entry it replaces. Returns the entry, or NULL if it could not be stored
+ (pixels are freed then).
+*/
+const CachedImage *image_cache_put(uint64_t key, unsigned char *pixels, int width, int height,
+                                   const unsigned char *source, int source_size, int scale, int gray);
+
+/* Drop every unpinned image; entries returned earlier become invalid */
+void image_cache_flush(void);
+
+/* Evict least recently used images until at most bytes are cached (pinned ones stay) */
+void image_cache_trim(size_t bytes);
+
+/* Keep an entry alive while it is used across frames */
+void image_cache_pin(const CachedImage *img);
+void image_cache_unpin(const CachedImage *img);
+
+/* malloc that flushes the cache and retries once when memory runs out */
+void *image_cache_alloc(size_t size);
+
+size_t image_cache_bytes(void);
+int image_cache_count(void);
+
+#endif /* IMAGE_CACHE_H */
@@ -0,0 +1,550 @@
+#include "jpeg_decode.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FAST_BITS   9
+
+/* Zigzag position -> natural (row-major) coefficient index */
+static const uint8_t natural_order[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+typedef struct {
+    uint16_t fast[1 << FAST_BITS];  /* code length << 8 | symbol, 0 = longer code */
+    int16_t fast_ac[1 << FAST_BITS];/* AC code and value together: value << 8 | run << 4 | bits, 0 = no */
+    uint32_t maxcode[17];           /* end of the codes of each length, left-aligned to 16 bits */
+    int first[17];                  /* first code of each length */
+    int offset[17];                 /* index in symbols of that first code */
+    uint8_t symbols[256];
+    int defined;
+} Huffman;
+
+typedef struct {
+    int id;
+    int h, v;                   /* sampling factors */
+    int tq;
+    int td, ta;                 /* DC / AC table of the current scan */
+    int pred;                   /* DC predictor */
+    int blocks_w, blocks_h;     /* blocks covering the component, without MCU padding */
+    int plane_w, plane_h;       /* samples at the decode scale, MCU padded */
+    uint8_t *plane;             /* NULL: entropy-decoded only */
+} Component;
+
+typedef struct {
+    const uint8_t *p, *end;
+    uint32_t acc;
+    int bits;
+    int marker;                 /* a marker was reached: zeros are fed from here on */
+} BitReader;
+
+typedef struct {
+    int width, height;
+    int ncomp;
+    Component comp[3];
+    int hmax, vmax;
+    int mcus_x, mcus_y;
+    uint16_t quant[4][64];      /* natural order */
+    Huffman dc[4], ac[4];
+    int restart_interval;
+    int adobe_transform;        /* -1 without an Adobe marker */
+    int n;                      /* IDCT output size: 8 / scale */
+    float idct[8][8];           /* [x][u] = c(u) / 2 * cos((2x + 1) u pi / 2n) */
+    int luma_only;
+} Decoder;
+
+static inline int read16(const uint8_t *p) {
+    return (p[0] << 8) | p[1];
+}
+
+static inline uint8_t clamp_u8(int v) {
+    return (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+/* ---------------------------------------------------------------- headers */
+
+static int build_huffman(Huffman *h, const uint8_t counts[16], const uint8_t *symbols, int total) {
+    memset(h, 0, sizeof(*h));
+    memcpy(h->symbols, symbols, total);
+
+    int code = 0, k = 0;
+    for (int len = 1; len <= 16; len++) {
+        h->offset[len] = k;
+        h->first[len] = code;
+        for (int i = 0; i < counts[len - 1]; i++, k++, code++) {
+            if (code >= (1 << len)) return 0;   // over-subscribed
+            if (len > FAST_BITS) continue;
+            int shift = FAST_BITS - len, lo = code << shift;
+            for (int j = 0; j < (1 << shift); j++) h->fast[lo + j] = (uint16_t)(len << 8 | symbols[k]);
+        }
+        h->maxcode[len] = (uint32_t)code << (16 - len);
+        code <<= 1;
+    }
+
+    // Short AC codes followed by a short value decode in one lookup
+    for (int i = 0; i < (1 << FAST_BITS); i++) {
+        int f = h->fast[i];
+        if (!f) continue;
+        int len = f >> 8, run = (f >> 4) & 15, size = f & 15;
+        if (size == 0 || len + size > FAST_BITS) continue;
+        int v = (i >> (FAST_BITS - len - size)) & ((1 << size) - 1);
+        if (v < (1 << (size - 1))) v -= (1 << size) - 1;
+        if (v >= -128 && v <= 127) h->fast_ac[i] = (int16_t)(v * 256 + run * 16 + len + size);
+    }
+    h->defined = 1;
+    return 1;
+}
+
+static int parse_dht(Decoder *d, const uint8_t *p, int len) {
+    while (len > 17) {
+        int tc = p[0] >> 4, th = p[0] & 15;
+        if (tc > 1 || th > 3) return 0;
+        int total = 0;
+        for (int i = 0; i < 16; i++) total += p[1 + i];
+        if (total > 256 || 17 + total > len) return 0;
+        if (!build_huffman(tc ? &d->ac[th] : &d->dc[th], p + 1, p + 17, total)) return 0;
+        p += 17 + total;
+        len -= 17 + total;
+    }
+    return len == 0;
+}
+
+static int parse_dqt(Decoder *d, const uint8_t *p, int len) {
+    while (len > 0) {
+        int pq = p[0] >> 4, tq = p[0] & 15;
+        int need = 1 + 64 * (pq ? 2 : 1);
+        if (pq > 1 || tq > 3 || len < need) return 0;
+        for (int i = 0; i < 64; i++) {
+            d->quant[tq][natural_order[i]] = (uint16_t)(pq ? read16(p + 1 + 2 * i) : p[1 + i]);
+        }
+        p += need;
+        len -= need;
+    }
+    return 1;
+}
+
+static int parse_frame(Decoder *d, const uint8_t *p, int len) {
+    if (len < 6) return 0;
+    d->height = read16(p + 1);
+    d->width = read16(p + 3);
+    d->ncomp = p[5];
+    if (p[0] != 8 || d->width == 0 || d->height == 0) return 0;
+    if ((d->ncomp != 1 && d->ncomp != 3) || len != 6 + 3 * d->ncomp) return 0;
+
+    d->hmax = d->vmax = 1;
+    for (int i = 0; i < d->ncomp; i++) {
+        Component *c = &d->comp[i];
+        c->id = p[6 + 3 * i];
+        c->h = p[7 + 3 * i] >> 4;
+        c->v = p[7 + 3 * i] & 15;
+        c->tq = p[8 + 3 * i];
+        if (c->h < 1 || c->h > 4 || c->v < 1 || c->v > 4 || c->tq > 3) return 0;
+        if (c->h > d->hmax) d->hmax = c->h;
+        if (c->v > d->vmax) d->vmax = c->v;
+    }
+
+    d->mcus_x = (d->width + 8 * d->hmax - 1) / (8 * d->hmax);
+    d->mcus_y = (d->height + 8 * d->vmax - 1) / (8 * d->vmax);
+    for (int i = 0; i < d->ncomp; i++) {
+        Component *c = &d->comp[i];
+        c->blocks_w = ((d->width * c->h + d->hmax - 1) / d->hmax + 7) / 8;
+        c->blocks_h = ((d->height * c->v + d->vmax - 1) / d->vmax + 7) / 8;
+    }
+    return 1;
+}
+
+/* Adobe RGB files and JFIF files whose components are named R, G, B carry no YCbCr */
+static int is_rgb(const Decoder *d) {
+    if (d->ncomp != 3) return 0;
+    if (d->adobe_transform == 0) return 1;
+    return d->comp[0].id == 'R' && d->comp[1].id == 'G' && d->comp[2].id == 'B';
+}
+
+/* ---------------------------------------------------------------- entropy */
+
+static void fill_bits(BitReader *b) {
+    while (b->bits <= 24) {
+        uint32_t c = 0;
+        if (!b->marker && b->p < b->end) {
+            c = *b->p++;
+            if (c == 0xFF) {
+                if (b->p < b->end && *b->p == 0x00) {
+                    b->p++;                 // stuffed byte
+                } else {
+                    b->marker = 1;
+                    b->p--;
+                    c = 0;
+                }
+            }
+        }
+        b->acc |= c << (24 - b->bits);
+        b->bits += 8;
+    }
+}
+
+static inline void consume(BitReader *b, int n) {
+    b->acc <<= n;
+    b->bits -= n;
+}
+
+static int huff_decode(BitReader *b, const Huffman *h) {
+    if (b->bits < 16) fill_bits(b);
+
+    int f = h->fast[b->acc >> (32 - FAST_BITS)];
+    if (f) {
+        consume(b, f >> 8);
+        return f & 255;
+    }
+
+    uint32_t code = b->acc >> 16;
+    int len = FAST_BITS + 1;
+    while (len <= 16 && code >= h->maxcode[len]) len++;
+    if (len > 16) return -1;
+
+    int idx = h->offset[len] + (int)(code >> (16 - len)) - h->first[len];
+    if (idx < 0 || idx > 255) return -1;
+    consume(b, len);
+    return h->symbols[idx];
+}
+
+static int receive_extend(BitReader *b, int s) {
+    if (s == 0) return 0;
+    if (b->bits < s) fill_bits(b);
+    int v = (int)(b->acc >> (32 - s));
+    consume(b, s);
+    return v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+}
+
+/* Resume after the RSTn marker the encoder put here */
+static void restart(BitReader *b) {
+    const uint8_t *p = b->p;
+    while (p + 1 < b->end && !(p[0] == 0xFF && p[1] != 0x00 && p[1] != 0xFF)) p++;
+    b->marker = 1;
+    if (p + 1 < b->end && p[1] >= 0xD0 && p[1] <= 0xD7) {
+        p += 2;
+        b->marker = 0;
+    }
+    b->p = p;
+    b->acc = 0;
+    b->bits = 0;
+}
+
+/*
+ One block; coefficients are dequantized into coef only inside the n x n
+ corner the reduced IDCT reads (coef NULL: decode and drop).
+*/
+static int decode_block(Decoder *d, BitReader *b, Component *c, float *coef) {
+    int t = huff_decode(b, &d->dc[c->td]);
+    if (t < 0 || t > 16) return 0;
+    c->pred += receive_extend(b, t);
+
+    const uint16_t *q = d->quant[c->tq];
+    int n = d->n;
+    if (coef) {
+        for (int v = 0; v < n; v++) memset(coef + v * 8, 0, n * sizeof(float));
+        coef[0] = (float)(c->pred * q[0]);
+    }
+
+    const Huffman *ac = &d->ac[c->ta];
+    for (int k = 1; k < 64;) {
+        if (b->bits < 16) fill_bits(b);
+        int fa = ac->fast_ac[b->acc >> (32 - FAST_BITS)];
+        if (fa) {
+            consume(b, fa & 15);
+            k += (fa >> 4) & 15;
+            if (k > 63) return 0;
+            int z = natural_order[k++];
+            if (coef && (z & 7) < n && (z >> 3) < n) coef[z] = (float)((fa >> 8) * q[z]);
+            continue;
+        }
+
+        int rs = huff_decode(b, ac);
+        if (rs < 0) return 0;
+        int r = rs >> 4, s = rs & 15;
+        if (s == 0) {
+            if (r != 15) break;             // end of block
+            k += 16;
+            continue;
+        }
+        k += r;
+        if (k > 63) return 0;
+        int v = receive_extend(b, s);
+        int z = natural_order[k++];
+        if (coef && (z & 7) < n && (z >> 3) < n) coef[z] = (float)(v * q[z]);
+    }
+    return 1;
+}
+
+/* ---------------------------------------------------------------- IDCT */
+
+static void init_idct(Decoder *d) {
+    const double pi = 3.14159265358979323846;
+    for (int x = 0; x < d->n; x++) {
+        for (int u = 0; u < d->n; u++) {
+            double cu = u == 0 ? sqrt(0.5) : 1.0;
+            d->idct[x][u] = (float)(cu / 2 * cos((2 * x + 1) * u * pi / (2 * d->n)));
+        }
+    }
+}
+
+/* n x n samples from the n x n low-frequency corner: the 8x8 block averaged down */
+static void idct_block(const Decoder *d, const float *coef, uint8_t *out, int stride) {
+    int n = d->n;
+    if (n == 1) {
+        out[0] = clamp_u8((int)floorf(coef[0] / 8 + 128.5f));
+        return;
+    }
+
+    float tmp[64];
+    for (int v = 0; v < n; v++) {
+        for (int x = 0; x < n; x++) {
+            float s = 0;
+            for (int u = 0; u < n; u++) s += d->idct[x][u] * coef[v * 8 + u];
+            tmp[v * 8 + x] = s;
+        }
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            float s = 128.5f;
+            for (int v = 0; v < n; v++) s += d->idct[y][v] * tmp[v * 8 + x];
+            out[y * stride + x] = clamp_u8((int)floorf(s));
+        }
+    }
+}
+
+static int decode_into(Decoder *d, BitReader *b, Component *c, int bx, int by) {
+    float coef[64];
+    if (!decode_block(d, b, c, c->plane ? coef : NULL)) return 0;
+    if (c->plane) idct_block(d, coef, c->plane + (size_t)by * d->n * c->plane_w + (size_t)bx * d->n, c->plane_w);
+    return 1;
+}
+
+/* ---------------------------------------------------------------- scans */
+
+/* Scan starting at its SOS segment; *next is set to the marker after the entropy data */
+static int decode_scan(Decoder *d, const uint8_t *seg, int len, const uint8_t *end, const uint8_t **next) {
+    int ns = len > 0 ? seg[0] : 0;
+    if (ns < 1 || ns > d->ncomp || len != 4 + 2 * ns) return 0;
+
+    Component *scan[3];
+    for (int i = 0; i < ns; i++) {
+        Component *c = NULL;
+        for (int j = 0; j < d->ncomp; j++) {
+            if (d->comp[j].id == seg[1 + 2 * i]) c = &d->comp[j];
+        }
+        if (!c) return 0;
+        c->td = seg[2 + 2 * i] >> 4;
+        c->ta = seg[2 + 2 * i] & 15;
+        if (c->td > 3 || c->ta > 3 || !d->dc[c->td].defined || !d->ac[c->ta].defined) return 0;
+        c->pred = 0;
+        scan[i] = c;
+    }
+
+    BitReader b = { .p = seg + len, .end = end };
+    int units_x = ns == 1 ? scan[0]->blocks_w : d->mcus_x;
+    int units_y = ns == 1 ? scan[0]->blocks_h : d->mcus_y;
+    int unit = 0;
+
+    for (int uy = 0; uy < units_y; uy++) {
+        for (int ux = 0; ux < units_x; ux++, unit++) {
+            if (d->restart_interval && unit > 0 && unit % d->restart_interval == 0) {
+                restart(&b);
+                for (int i = 0; i < ns; i++) scan[i]->pred = 0;
+            }
+
+            // A single-component scan walks blocks; an interleaved one walks MCUs
+            if (ns == 1) {
+                if (!decode_into(d, &b, scan[0], ux, uy)) return 0;
+                continue;
+            }
+            for (int i = 0; i < ns; i++) {
+                Component *c = scan[i];
+                for (int v = 0; v < c->v; v++) {
+                    for (int h = 0; h < c->h; h++) {
+                        if (!decode_into(d, &b, c, ux * c->h + h, uy * c->v + v)) return 0;
+                    }
+                }
+            }
+        }
+    }
+
+    const uint8_t *p = b.p;
+    while (p + 1 < end && !(p[0] == 0xFF && p[1] != 0x00 && !(p[1] >= 0xD0 && p[1] <= 0xD7))) p++;
+    *next = p;
+    return 1;
+}
+
+static int alloc_planes(Decoder *d) {
+    int chroma = !d->luma_only || is_rgb(d);
+    for (int i = 0; i < d->ncomp; i++) {
+        Component *c = &d->comp[i];
+        if (c->plane || (i > 0 && !chroma)) continue;
+        c->plane_w = d->mcus_x * c->h * d->n;
+        c->plane_h = d->mcus_y * c->v * d->n;
+        c->plane = (uint8_t *)calloc((size_t)c->plane_w * c->plane_h, 1);
+        if (!c->plane) return 0;
+    }
+    return 1;
+}
+
+/* Walk the markers; with header_only, stop at the frame header */
+static int parse(Decoder *d, const uint8_t *data, int size, int header_only) {
+    const uint8_t *p = data, *end = data + size;
+    if (size < 4 || p[0] != 0xFF || p[1] != 0xD8) return 0;
+    p += 2;
+
+    int have_frame = 0, scans = 0;
+    for (;;) {
+        while (p < end && *p != 0xFF) p++;
+        while (p < end && *p == 0xFF) p++;      // fill bytes
+        if (p >= end) return scans > 0;         // truncated: keep what was decoded
+        int m = *p++;
+        if (m == 0xD9) return scans > 0;
+        if ((m >= 0xD0 && m <= 0xD7) || m == 0x01) continue;
+
+        if (end - p < 2) return scans > 0;
+        int len = read16(p);
+        if (len < 2 || len > end - p) return 0;
+        const uint8_t *seg = p + 2;
+        int seg_len = len - 2;
+
+        switch (m) {
+            case 0xC0:      // baseline
+            case 0xC1:      // extended sequential, Huffman
+                if (have_frame || !parse_frame(d, seg, seg_len)) return 0;
+                have_frame = 1;
+                if (header_only) return 1;
+                break;
+            case 0xC4:
+                if (!parse_dht(d, seg, seg_len)) return 0;
+                break;
+            case 0xDB:
+                if (!parse_dqt(d, seg, seg_len)) return 0;
+                break;
+            case 0xDD:
+                if (seg_len < 2) return 0;
+                d->restart_interval = read16(seg);
+                break;
+            case 0xDA:
+                if (!have_frame || !alloc_planes(d)) return 0;
+                if (!decode_scan(d, seg, seg_len, end, &p)) return 0;
+                scans++;
+                continue;
+            case 0xEE:
+                if (seg_len >= 12 && memcmp(seg, "Adobe", 5) == 0) d->adobe_transform = seg[11];
+                break;
+            default:
+                // Any other SOFn (progressive, lossless, arithmetic) and DNL are not handled
+                if (((m & 0xF0) == 0xC0 && m != 0xC8 && m != 0xCC) || m == 0xDC) return 0;
+                break;
+        }
+        p += len;
+    }
+}
+
+/* ---------------------------------------------------------------- output */
+
+static void write_rgba(const Decoder *d, unsigned char *rgba, int out_w, int out_h, int *cols[3]) {
+    const Component *c = d->comp;
+    int rgb = is_rgb(d);
+    int color = d->ncomp == 3 && c[1].plane;
+
+    for (int y = 0; y < out_h; y++) {
+        const uint8_t *row[3];
+        for (int i = 0; i < (color ? 3 : 1); i++) {
+            row[i] = c[i].plane + (size_t)(y * c[i].v / d->vmax) * c[i].plane_w;
+        }
+        unsigned char *dst = rgba + (size_t)y * out_w * 4;
+
+        for (int x = 0; x < out_w; x++, dst += 4) {
+            int a = row[0][cols[0][x]];
+            int r = a, g = a, bl = a;
+            if (color) {
+                int p1 = row[1][cols[1][x]], p2 = row[2][cols[2][x]];
+                if (rgb) {
+                    g = p1;
+                    bl = p2;
+                } else {
+                    int cb = p1 - 128, cr = p2 - 128;
+                    r = a + ((91881 * cr + 32768) >> 16);
+                    g = a - ((22554 * cb + 46802 * cr + 32768) >> 16);
+                    bl = a + ((116130 * cb + 32768) >> 16);
+                }
+                if (d->luma_only) r = g = bl = (77 * clamp_u8(r) + 150 * clamp_u8(g) + 29 * clamp_u8(bl)) >> 8;
+            }
+            dst[0] = clamp_u8(r);
+            dst[1] = clamp_u8(g);
+            dst[2] = clamp_u8(bl);
+            dst[3] = 255;
+        }
+    }
+}
+
+int jpeg_info(const unsigned char *data, int size, int *width, int *height) {
+    Decoder *d = (Decoder *)calloc(1, sizeof(Decoder));
+    if (!d) return 0;
+    d->adobe_transform = -1;
+    int ok = parse(d, data, size, 1);
+    if (ok) {
+        *width = d->width;
+        *height = d->height;
+    }
+    free(d);
+    return ok;
+}
+
+int jpeg_pick_scale(int width, int min_width) {
+    for (int s = 8; s > 1; s /= 2) {
+        if ((width + s - 1) / s >= min_width) return s;
+    }
+    return 1;
+}
+
+unsigned char *jpeg_decode(const unsigned char *data, int size, int scale, int flags,
+                           int *width, int *height) {
+    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) return NULL;
+
+    Decoder *d = (Decoder *)calloc(1, sizeof(Decoder));
+    if (!d) return NULL;
+    d->adobe_transform = -1;
+    d->n = 8 / scale;
+    d->luma_only = (flags & JPEG_GRAY) != 0;
+    init_idct(d);
+
+    unsigned char *rgba = NULL;
+    int *cols[3] = { NULL, NULL, NULL };
+    if (!parse(d, data, size, 0) || !d->comp[0].plane) goto done;
+
+    int out_w = (d->width + scale - 1) / scale;
+    int out_h = (d->height + scale - 1) / scale;
+
+    // Source column of each output column, per component (chroma is upsampled by repetition)
+    int planes = d->comp[1].plane ? 3 : 1;
+    for (int i = 0; i < planes; i++) {
+        cols[i] = (int *)malloc((size_t)out_w * sizeof(int));
+        if (!cols[i]) goto done;
+        for (int x = 0; x < out_w; x++) cols[i][x] = x * d->comp[i].h / d->hmax;
+    }
+
+    rgba = (unsigned char *)malloc((size_t)out_w * out_h * 4);
+    if (!rgba) goto done;
+    write_rgba(d, rgba, out_w, out_h, cols);
+    *width = out_w;
+    *height = out_h;
+
+done:
+    for (int i = 0; i < 3; i++) {
+        free(cols[i]);
+        free(d->comp[i].plane);
+    }
+    free(d);
+    return rgba;
+}
@@ -0,0 +1,31 @@
+#ifndef JPEG_DECODE_H
+#define JPEG_DECODE_H
+
+/*
+Scaled baseline JPEG decoder
+
+Decodes straight to 1/1, 1/2, 1/4 or 1/8 of the full size by running a
+reduced IDCT on the low-frequency corner of each 8x8 block, so a large photo
+never exists at full resolution. With JPEG_GRAY the chroma blocks are only
+entropy-decoded (to stay in sync) and luma is written to R, G and B.
+
+Progressive, arithmetic-coded, 12-bit, CMYK and DNL files are refused; the
+caller falls back to stb_image for those.
+*/
+
+#define JPEG_GRAY   1       /* luma only */
+
+/* Full size of a JPEG this decoder accepts; 0 if it is not one */
+int jpeg_info(const unsigned char *data, int size, int *width, int *height);
+
+/* Largest scale (8, 4, 2 or 1) that still leaves at least min_width pixels across */
+int jpeg_pick_scale(int width, int min_width);
+
+/*
+ RGBA pixels of the image at 1/scale (malloc'd, ceil(full / scale) in each
+ direction). NULL if the file is refused, corrupt or memory runs out.
+*/
+unsigned char *jpeg_decode(const unsigned char *data, int size, int scale, int flags,
+                           int *width, int *height);
+
+#endif /* JPEG_DECODE_H */
@@ -0,0 +1,132 @@
+#include "luma_pyramid.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Level sizes: halved (rounded up) until a side reaches 1 */
+static int level_sizes(int width, int height, int *w, int *h) {
+    int n = 0;
+    while (n < LUMA_PYRAMID_LEVELS) {
+        w[n] = width;
+        h[n] = height;
+        n++;
+        if (width == 1 || height == 1) break;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    return n;
+}
+
+size_t luma_pyramid_bytes(int width, int height) {
+    int w[LUMA_PYRAMID_LEVELS], h[LUMA_PYRAMID_LEVELS];
+    int n = level_sizes(width, height, w, h);
+    size_t total = 0;
+    for (int i = 0; i < n; i++) total += (size_t)w[i] * h[i];
+    return total;
+}
+
+/* 2 x 2 average of src into dst; the last row / column of an odd side is repeated */
+static void downsample(const LumaLevel *src, const LumaLevel *dst) {
+    for (int y = 0; y < dst->height; y++) {
+        const uint8_t *r0 = src->luma + (size_t)(2 * y) * src->width;
+        const uint8_t *r1 = 2 * y + 1 < src->height ? r0 + src->width : r0;
+        uint8_t *out = dst->luma + (size_t)y * dst->width;
+
+        int pairs = src->width / 2;
+        for (int x = 0; x < pairs; x++) {
+            out[x] = (uint8_t)((r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] + 2) >> 2);
+        }
+        if (pairs < dst->width) {
+            int last = src->width - 1;
+            out[pairs] = (uint8_t)((r0[last] + r1[last] + 1) >> 1);
+        }
+    }
+}
+
+int luma_pyramid_build(LumaPyramid *p, const unsigned char *rgba, int width, int height) {
+    memset(p, 0, sizeof(*p));
+    if (width <= 0 || height <= 0) return 0;
+
+    int w[LUMA_PYRAMID_LEVELS], h[LUMA_PYRAMID_LEVELS];
+    p->levels = level_sizes(width, height, w, h);
+    p->data = (uint8_t *)malloc(luma_pyramid_bytes(width, height));
+    if (!p->data) return 0;
+
+    uint8_t *next = p->data;
+    for (int i = 0; i < p->levels; i++) {
+        p->level[i].width = w[i];
+        p->level[i].height = h[i];
+        p->level[i].luma = next;
+        next += (size_t)w[i] * h[i];
+    }
+
+    // Same integer luma as mode=shape
+    size_t n = (size_t)width * height;
+    for (size_t i = 0; i < n; i++, rgba += 4) {
+        p->data[i] = (uint8_t)((77 * rgba[0] + 150 * rgba[1] + 29 * rgba[2]) >> 8);
+    }
+    for (int i = 1; i < p->levels; i++) downsample(&p->level[i - 1], &p->level[i]);
+    return 1;
+}
+
+void luma_pyramid_free(LumaPyramid *p) {
+    if (!p) return;
+    free(p->data);
+    memset(p, 0, sizeof(*p));
+}
+
+/* Source index and 8-bit weight of the right / lower neighbour for each output position */
+static void sample_taps(float start, float step, int count, int size, int *index, uint8_t *weight) {
+    for (int i = 0; i < count; i++) {
+        float s = start + (i + 0.5f) * step - 0.5f;
+        if (s < 0) s = 0;
+        if (s > size - 1) s = (float)(size - 1);
+        int i0 = (int)s;
+        index[i] = i0;
+        weight[i] = (uint8_t)((s - i0) * 255.0f + 0.5f);
+    }
+}
+
+void luma_pyramid_sample(const LumaPyramid *p, float x, float y, float w, float h,
+                         int out_w, int out_h, uint8_t *out) {
+    if (p->levels == 0 || out_w <= 0 || out_h <= 0) return;
+
+    // Finest level with at most 2 source pixels per output pixel
+    float scale = w / out_w > h / out_h ? w / out_w : h / out_h;
+    int l = 0;
+    while (l + 1 < p->levels && scale >= 2.0f) {
+        scale *= 0.5f;
+        l++;
+    }
+    const LumaLevel *lv = &p->level[l];
+    float fx = (float)lv->width / p->level[0].width;
+    float fy = (float)lv->height / p->level[0].height;
+
+    int *xi = (int *)malloc((size_t)out_w * sizeof(int));
+    uint8_t *xw = (uint8_t *)malloc(out_w);
+    if (!xi || !xw) {
+        free(xi);
+        free(xw);
+        memset(out, 0, (size_t)out_w * out_h);
+        return;
+    }
+    sample_taps(x * fx, w * fx / out_w, out_w, lv->width, xi, xw);
+
+    for (int j = 0; j < out_h; j++) {
+        int yi;
+        uint8_t yw;
+        sample_taps(y * fy + j * (h * fy / out_h), h * fy / out_h, 1, lv->height, &yi, &yw);
+        const uint8_t *r0 = lv->luma + (size_t)yi * lv->width;
+        const uint8_t *r1 = yi + 1 < lv->height ? r0 + lv->width : r0;
+        uint8_t *dst = out + (size_t)j * out_w;
+
+        for (int i = 0; i < out_w; i++) {
+            int x0 = xi[i], x1 = x0 + 1 < lv->width ? x0 + 1 : x0;
+            int a = xw[i], b = yw;
+            int top = r0[x0] * (255 - a) + r0[x1] * a;
+            int bottom = r1[x0] * (255 - a) + r1[x1] * a;
+            dst[i] = (uint8_t)((top * (255 - b) + bottom * b + 32512) / 65025);
+        }
+    }
+    free(xi);
+    free(xw);
+}
@@ -0,0 +1,45 @@
+#ifndef LUMA_PYRAMID_H
+#define LUMA_PYRAMID_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Luma mip pyramid
+
+Level 0 is the image's luma plane; every next level averages 2 x 2 pixels
+of the one before (odd edges repeat their last pixel), down to a single
+row or column. A crop at any zoom is resampled bilinearly from the finest
+level with no more than 2 source pixels per output pixel, so the cost
+depends on the output size only, not on the source resolution.
+*/
+
+#define LUMA_PYRAMID_LEVELS 16
+
+typedef struct {
+    int width;
+    int height;
+    uint8_t *luma;
+} LumaLevel;
+
+typedef struct {
+    int levels;
+    LumaLevel level[LUMA_PYRAMID_LEVELS];
+    uint8_t *data;          /* every level, one allocation */
+} LumaPyramid;
+
+/* Bytes a pyramid over width x height takes */
+size_t luma_pyramid_bytes(int width, int height);
+
+/* Build from RGBA pixels; returns 0 on failure (out of memory) */
+int luma_pyramid_build(LumaPyramid *p, const unsigned char *rgba, int width, int height);
+void luma_pyramid_free(LumaPyramid *p);
+
+/*
+ The crop x, y, w, h (level 0 pixels, may be fractional) resampled to
+ out_w * out_h luma.
+*/
+void luma_pyramid_sample(const LumaPyramid *p, float x, float y, float w, float h,
+                         int out_w, int out_h, uint8_t *out);
+
+#endif /* LUMA_PYRAMID_H */
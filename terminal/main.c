@@ -14,6 +14,9 @@
 #include "settings.h"
 #include "cmd.h"
 #include "ascii_converter.h"
+#include "ascii_anim.h"
+#include "ascii_view.h"
+#include "pipeline_mem.h"
 #include "sdl.h"
 #include "translate.h"
 #include "forecast.h"
@@ -31,10 +34,79 @@ EM_JS(void, disable_canvas_smoothing, (), {
         canvas.style.imageRendering = "-moz-crisp-edges";
     }, 0);
 });
+
+/*
+ Files dropped onto the canvas are written to MEMFS as they are (no base64) and
+ queued. They stay for later runs with other options; past DROP_KEEP files the
+ oldest is removed.
+*/
+#define DROP_KEEP  8
+EM_JS(void, enable_file_drop, (int keep), {
+    var canvas = Module.canvas;
+    if (!canvas) return;
+    canvas.addEventListener("dragover", function (e) { e.preventDefault(); });
+    canvas.addEventListener("drop", function (e) {
+        e.preventDefault();
+        var files = e.dataTransfer ? e.dataTransfer.files : [];
+        for (var i = 0; i < files.length; i++) {
+            (function (file) {
+                file.arrayBuffer().then(function (buf) {
+                    var path = "/drop/" + file.name.replace(/[\s\/]/g, "_");
+                    try { FS.mkdir("/drop"); } catch (err) {}
+                    FS.writeFile(path, new Uint8Array(buf));
+                    (Module.rekav_dropped = Module.rekav_dropped || []).push(path);
+
+                    // Dropping a name again replaces it and makes it the newest
+                    var kept = Module.rekav_drop_files = Module.rekav_drop_files || [];
+                    var at = kept.indexOf(path);
+                    if (at >= 0) kept.splice(at, 1);
+                    kept.push(path);
+                    // Drops still waiting to be converted are not evicted yet
+                    for (var j = 0; kept.length > keep && j < kept.length; ) {
+                        if (Module.rekav_dropped.indexOf(kept[j]) >= 0) { j++; continue; }
+                        try { FS.unlink(kept[j]); } catch (err) {}
+                        kept.splice(j, 1);
+                    }
+                });
+            })(files[i]);
+        }
+    });
+});
+
+/* Next queued drop path into out; 0 if none, -1 (file removed) if it does not fit */
+EM_JS(int, next_dropped_file, (char *out, int size), {
+    var queue = Module.rekav_dropped;
+    if (!queue || queue.length == 0) return 0;
+    var path = queue.shift();
+    if (lengthBytesUTF8(path) >= size) {
+        try { FS.unlink(path); } catch (err) {}
+        return -1;
+    }
+    stringToUTF8(path, out, size);
+    return 1;
+});
 #endif
 
 AppContext app = {ZERO_MEMORY};
 
+/* A dropped file runs as if "to_ascii <path>" had been typed */
+static void convert_dropped_file(const char *path) {
+    if (strchr(path, ' ')) {
+        add_terminal_line("Error: Dropped file paths cannot contain spaces", LINE_FLAG_ERROR);
+        return;
+    }
+    // Longer commands would be cut short by execute_command
+    char cmd[MAX_LINE_LENGTH], echo[MAX_LINE_LENGTH + 128];
+    if (strlen(path) >= sizeof(cmd) - strlen("to_ascii ")) {
+        add_terminal_line("Error: Dropped file name is too long", LINE_FLAG_ERROR);
+        return;
+    }
+    snprintf(cmd, sizeof(cmd), "to_ascii %s", path);
+    snprintf(echo, sizeof(echo), "%.*s%s", _terminal.input.prompt_len, _terminal.input.buffer, cmd);
+    add_terminal_line(echo, LINE_FLAG_PROMPT);
+    execute_command(cmd);
+}
+
 void app_init(void) {
 
     memset(&app, ZERO_MEMORY, sizeof(AppContext));
@@ -129,6 +201,9 @@ void app_init(void) {
 }
 
 void app_cleanup(void) {
+    ascii_anim_stop();
+    ascii_view_stop();
+    ascii_preview_cancel();
     cleanup_sdl(&app.sdl);
 
     if (app.terminal.settings.font) {
@@ -328,16 +403,16 @@ void reset_current_input() {
     _terminal.input.texture_h = 0;
 }
 
-void add_terminal_line(const char *text, TerminalLineFlags flags)
+static TerminalLine *append_terminal_line(void)
 {
     // FIFO: buffer full, drop the oldest line
     if (_terminal.line_count == MAX_LINES) {
 
         // Destroy texture of the oldest line
-        if (_terminal.lines[0].texture) {
+        if (_terminal.lines[0].texture && !(_terminal.lines[0].flags & LINE_FLAG_ANIMATED)) {
             SDL_DestroyTexture(_terminal.lines[0].texture);
-            _terminal.lines[0].texture = NULL;
         }
+        _terminal.lines[0].texture = NULL;
 
         // Shift everything up by one (FIFO)
         memmove(
@@ -350,9 +425,40 @@ void add_terminal_line(const char *text, TerminalLineFlags flags)
     }
 
     // Append new line at tail
-    int idx = _terminal.line_count;
-    TerminalLine *line = &_terminal.lines[idx];
+    TerminalLine *line = &_terminal.lines[_terminal.line_count];
     memset(line, 0, sizeof(*line));
+    return line;
+}
+
+TerminalLine *add_terminal_texture_line(SDL_Texture *texture, int w, int h, TerminalLineFlags flags)
+{
+    TerminalLine *line = append_terminal_line();
+
+    // Scale down to the text column, keeping the aspect ratio
+    int max_width = _terminal.width - TERMINAL_PADDING_LEFT - TERMINAL_PADDING_RIGHT - 4;
+    if (w > max_width && max_width > 0) {
+        h = (int)((long long)h * max_width / w);
+        w = max_width;
+    }
+
+    line->font        = _terminal.settings.font;
+    line->flags       = flags;
+    line->texture     = texture;
+    line->width       = w;
+    line->height      = h;
+    line->line_height = h;
+
+    _terminal.line_count++;
+    _terminal.dirty = TRUE;
+
+    update_max_scroll();
+    _terminal.scroll_offset_px = _terminal.max_scroll;
+    return line;
+}
+
+void add_terminal_line(const char *text, TerminalLineFlags flags)
+{
+    TerminalLine *line = append_terminal_line();
 
     // UTF-8 safe copy
     size_t len = strnlen(text, MAX_LINE_LENGTH - 1);
@@ -737,6 +843,7 @@ void main_loop() {
 	        editor_handle_event(&e);
 	        continue;
 	    }
+        if (ascii_view_active() && ascii_view_handle_event(&e)) continue;
         switch (e.type) {
             case SDL_QUIT:
                 _terminal.running = FALSE;
@@ -747,6 +854,16 @@ void main_loop() {
 		            handle_keyboard_event(&e);
 		        break;
 
+            case SDL_DROPFILE:
+                // Native builds: the path on disk
+                if (_image_processing_pending) {
+                    add_terminal_line("Warning: Image still loading, drop the file again", LINE_FLAG_WARNING);
+                } else {
+                    convert_dropped_file(e.drop.file);
+                }
+                SDL_free(e.drop.file);
+                break;
+
             case SDL_MOUSEWHEEL:
                 _terminal.scroll_offset_px -= e.wheel.y * SCROLL_DELTA_MULTIPLIER;
                 if (_terminal.scroll_offset_px < 0)
@@ -772,6 +889,16 @@ void main_loop() {
         editor_render();   // ← Render the editor (full screen + status bar)
         return;            // ← Skip terminal render
     }
+    if (ascii_anim_active()) {
+        ascii_anim_tick();
+    }
+    if (ascii_preview_active()) {
+        ascii_preview_tick();
+    }
+    if (ascii_view_active()) {
+        ascii_view_tick();
+    }
+    pipeline_tick();
     if (_terminal.dirty || _terminal.input.dirty) {
         render_terminal();
     }
@@ -785,11 +912,22 @@ void main_loop() {
     if (_image_processing_pending) {
 	    poll_image_result();
     }
+#ifdef __EMSCRIPTEN__
+    // Dropped files wait for the image being fetched
+    char dropped[MAX_LINE_LENGTH];
+    int got = _image_processing_pending ? 0 : next_dropped_file(dropped, sizeof(dropped));
+    if (got < 0) {
+        add_terminal_line("Error: Dropped file name is too long", LINE_FLAG_ERROR);
+    } else if (got) {
+        convert_dropped_file(dropped);
+    }
+#endif
 }
 
 int main() {
 	app_init();
 	disable_canvas_smoothing();
+	enable_file_drop(DROP_KEEP);
     emscripten_set_main_loop(main_loop, FALSE, TRUE);
     cleanup_sdl(&_sdl);
     return 0;
@@ -0,0 +1,246 @@
+#include "palette.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ Entries as 16-bit lanes: (r, g) pairs and (b, 0) pairs, so one multiply-add
+ of the differences gives dr^2 + dg^2 (and db^2) per entry in 32 bits. The
+ tail is padded with far-away entries to a multiple of 4.
+*/
+typedef struct {
+    int count;
+    int padded;
+    int16_t rg[PALETTE_MAX * 2];
+    int16_t b[PALETTE_MAX * 2];
+} PaletteLanes;
+
+#define LANE_FAR 1000
+
+static void palette_lanes(const Palette *pal, PaletteLanes *l) {
+    l->count = pal->count;
+    l->padded = (pal->count + 3) & ~3;
+    for (int i = 0; i < l->padded; i++) {
+        const uint8_t *c = pal->rgb + i * 3;
+        int in = i < pal->count;
+        l->rg[2 * i] = (int16_t)(in ? c[0] : LANE_FAR);
+        l->rg[2 * i + 1] = (int16_t)(in ? c[1] : LANE_FAR);
+        l->b[2 * i] = (int16_t)(in ? c[2] : LANE_FAR);
+        l->b[2 * i + 1] = 0;
+    }
+}
+
+/* Index of the nearest entry; the first one wins ties */
+static int nearest(const PaletteLanes *l, int r, int g, int b) {
+    int best = INT_MAX, best_i = 0;
+#if defined(__wasm_simd128__) || defined(__SSE2__)
+    int32_t dist[4], idx[4];
+#if defined(__wasm_simd128__)
+    v128_t prg = wasm_i32x4_splat((g << 16) | r), pb = wasm_i32x4_splat(b);
+    v128_t bd = wasm_i32x4_splat(INT_MAX), bi = wasm_i32x4_splat(0);
+    v128_t cur = wasm_i32x4_make(0, 1, 2, 3), four = wasm_i32x4_splat(4);
+    for (int i = 0; i < l->padded; i += 4) {
+        v128_t drg = wasm_i16x8_sub(prg, wasm_v128_load(l->rg + 2 * i));
+        v128_t db = wasm_i16x8_sub(pb, wasm_v128_load(l->b + 2 * i));
+        v128_t d = wasm_i32x4_add(wasm_i32x4_dot_i16x8(drg, drg), wasm_i32x4_dot_i16x8(db, db));
+        v128_t lt = wasm_i32x4_lt(d, bd);
+        bd = wasm_v128_bitselect(d, bd, lt);
+        bi = wasm_v128_bitselect(cur, bi, lt);
+        cur = wasm_i32x4_add(cur, four);
+    }
+    wasm_v128_store(dist, bd);
+    wasm_v128_store(idx, bi);
+#else
+    __m128i prg = _mm_set1_epi32((g << 16) | r), pb = _mm_set1_epi32(b);
+    __m128i bd = _mm_set1_epi32(INT_MAX), bi = _mm_setzero_si128();
+    __m128i cur = _mm_setr_epi32(0, 1, 2, 3), four = _mm_set1_epi32(4);
+    for (int i = 0; i < l->padded; i += 4) {
+        __m128i drg = _mm_sub_epi16(prg, _mm_loadu_si128((const __m128i *)(l->rg + 2 * i)));
+        __m128i db = _mm_sub_epi16(pb, _mm_loadu_si128((const __m128i *)(l->b + 2 * i)));
+        __m128i d = _mm_add_epi32(_mm_madd_epi16(drg, drg), _mm_madd_epi16(db, db));
+        __m128i lt = _mm_cmplt_epi32(d, bd);
+        bd = _mm_or_si128(_mm_and_si128(lt, d), _mm_andnot_si128(lt, bd));
+        bi = _mm_or_si128(_mm_and_si128(lt, cur), _mm_andnot_si128(lt, bi));
+        cur = _mm_add_epi32(cur, four);
+    }
+    _mm_storeu_si128((__m128i *)dist, bd);
+    _mm_storeu_si128((__m128i *)idx, bi);
+#endif
+    for (int k = 0; k < 4; k++) {
+        if (dist[k] < best || (dist[k] == best && idx[k] < best_i)) {
+            best = dist[k];
+            best_i = idx[k];
+        }
+    }
+#else
+    for (int i = 0; i < l->count; i++) {
+        int dr = r - l->rg[2 * i], dg = g - l->rg[2 * i + 1], db = b - l->b[2 * i];
+        int d = dr * dr + dg * dg + db * db;
+        if (d < best) {
+            best = d;
+            best_i = i;
+        }
+    }
+#endif
+    return best_i;
+}
+
+typedef struct {
+    int start;
+    int end;
+} Box;
+
+/* Widest channel of samples[start, end) and its range */
+static int box_range(const uint8_t *s, const Box *box, int *channel) {
+    int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+    for (int i = box->start; i < box->end; i++) {
+        for (int c = 0; c < 3; c++) {
+            int v = s[i * 3 + c];
+            if (v < lo[c]) lo[c] = v;
+            if (v > hi[c]) hi[c] = v;
+        }
+    }
+    int best = 0;
+    for (int c = 1; c < 3; c++) {
+        if (hi[c] - lo[c] > hi[best] - lo[best]) best = c;
+    }
+    *channel = best;
+    return hi[best] - lo[best];
+}
+
+/* Split box at the median of channel; both halves keep at least one sample */
+static void box_split(uint8_t *s, Box *box, int channel, Box *right) {
+    int hist[256] = { 0 };
+    int n = box->end - box->start, lo = 255, hi = 0;
+    for (int i = box->start; i < box->end; i++) {
+        int v = s[i * 3 + channel];
+        hist[v]++;
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+    }
+    int median = lo, seen = 0;
+    while (seen + hist[median] < (n + 1) / 2) seen += hist[median++];
+    int cut = median < hi ? median : median - 1;    // left gets values <= cut
+
+    int mid = box->start;
+    for (int i = box->start; i < box->end; i++) {
+        if (s[i * 3 + channel] <= cut) {
+            uint8_t t[3];
+            memcpy(t, s + i * 3, 3);
+            memcpy(s + i * 3, s + mid * 3, 3);
+            memcpy(s + mid * 3, t, 3);
+            mid++;
+        }
+    }
+    right->start = mid;
+    right->end = box->end;
+    box->end = mid;
+}
+
+int palette_build(Palette *pal, const uint8_t *rgba, size_t count, int colors) {
+    pal->count = 0;
+    if (count == 0) return 0;
+    if (colors < 2) colors = 2;
+    if (colors > PALETTE_MAX) colors = PALETTE_MAX;
+
+    int n = count < PALETTE_SAMPLES ? (int)count : PALETTE_SAMPLES;
+    uint8_t *s = (uint8_t *)malloc((size_t)n * 3);
+    Box *boxes = (Box *)malloc(sizeof(Box) * colors);
+    if (!s || !boxes) {
+        free(s);
+        free(boxes);
+        return 0;
+    }
+    for (int i = 0; i < n; i++) memcpy(s + i * 3, rgba + (size_t)i * count / n * 4, 3);
+
+    // Median cut: split the box with the widest channel range until there are enough
+    int nbox = 1;
+    boxes[0].start = 0;
+    boxes[0].end = n;
+    while (nbox < colors) {
+        int pick = -1, pick_range = 0, pick_channel = 0;
+        for (int b = 0; b < nbox; b++) {
+            int channel, range = box_range(s, &boxes[b], &channel);
+            if (range > pick_range) {
+                pick = b;
+                pick_range = range;
+                pick_channel = channel;
+            }
+        }
+        if (pick < 0) break;    // every box holds a single color
+        box_split(s, &boxes[pick], pick_channel, &boxes[nbox++]);
+    }
+
+    for (int b = 0; b < nbox; b++) {
+        int sum[3] = { 0, 0, 0 }, size = boxes[b].end - boxes[b].start;
+        for (int i = boxes[b].start; i < boxes[b].end; i++) {
+            for (int c = 0; c < 3; c++) sum[c] += s[i * 3 + c];
+        }
+        for (int c = 0; c < 3; c++) pal->rgb[b * 3 + c] = (uint8_t)((sum[c] + size / 2) / size);
+    }
+    pal->count = nbox;
+    free(boxes);
+
+    // k-means from the median cut seeds; clusters that lose every sample keep their center
+    PaletteLanes lanes;
+    int (*sum)[4] = (int (*)[4])malloc(sizeof(int[4]) * nbox);
+    for (int iter = 0; sum && iter < PALETTE_ITERATIONS; iter++) {
+        palette_lanes(pal, &lanes);
+        memset(sum, 0, sizeof(int[4]) * nbox);
+        for (int i = 0; i < n; i++) {
+            const uint8_t *p = s + i * 3;
+            int k = nearest(&lanes, p[0], p[1], p[2]);
+            sum[k][0] += p[0];
+            sum[k][1] += p[1];
+            sum[k][2] += p[2];
+            sum[k][3]++;
+        }
+        int moved = 0;
+        for (int k = 0; k < nbox; k++) {
+            if (sum[k][3] == 0) continue;
+            for (int c = 0; c < 3; c++) {
+                uint8_t v = (uint8_t)((sum[k][c] + sum[k][3] / 2) / sum[k][3]);
+                moved |= v != pal->rgb[k * 3 + c];
+                pal->rgb[k * 3 + c] = v;
+            }
+        }
+        if (!moved) break;
+    }
+
+    free(sum);
+    free(s);
+    return pal->count;
+}
+
+void palette_map(const Palette *pal, const uint8_t *rgba, size_t count, uint8_t *index) {
+    PaletteLanes lanes;
+    palette_lanes(pal, &lanes);
+
+    // Neighbouring pixels often repeat, especially in upscaled art
+    int last = -1, last_i = 0;
+    for (size_t i = 0; i < count; i++, rgba += 4) {
+        int key = rgba[0] | rgba[1] << 8 | rgba[2] << 16;
+        if (key != last) {
+            last = key;
+            last_i = nearest(&lanes, rgba[0], rgba[1], rgba[2]);
+        }
+        index[i] = (uint8_t)last_i;
+    }
+}
+
+void palette_expand(const Palette *pal, const uint8_t *index, size_t count, uint8_t *rgba) {
+    for (size_t i = 0; i < count; i++, rgba += 4) {
+        memcpy(rgba, pal->rgb + index[i] * 3, 3);
+        rgba[3] = 255;
+    }
+}
+
+int palette_bits(const Palette *pal) {
+    return pal->count <= 2 ? 1 : pal->count <= 4 ? 2 : pal->count <= 16 ? 4 : 8;
+}
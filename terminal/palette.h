@@ -0,0 +1,37 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Color palettes for palette=N
+
+At most PALETTE_SAMPLES evenly spread pixels are split by median cut into N
+boxes, whose means seed a few k-means rounds. Mapping to the nearest entry
+compares one pixel against 4 palette entries per SIMD step (squared RGB
+distance), so a 256-color palette costs 64 steps per pixel.
+*/
+
+#define PALETTE_MAX         256
+#define PALETTE_SAMPLES     8192
+#define PALETTE_ITERATIONS  8
+
+typedef struct {
+    int count;
+    uint8_t rgb[PALETTE_MAX * 3];
+} Palette;
+
+/* Up to colors (2 .. PALETTE_MAX) entries fitted to count RGBA pixels; returns the count, 0 on failure */
+int palette_build(Palette *pal, const uint8_t *rgba, size_t count, int colors);
+
+/* Nearest palette index of each RGBA pixel */
+void palette_map(const Palette *pal, const uint8_t *rgba, size_t count, uint8_t *index);
+
+/* RGBA pixels (opaque) back from indices */
+void palette_expand(const Palette *pal, const uint8_t *index, size_t count, uint8_t *rgba);
+
+/* Smallest indexed PNG depth (1, 2, 4, 8) that holds the palette */
+int palette_bits(const Palette *pal);
+
+#endif /* PALETTE_H */
@@ -0,0 +1,88 @@
+#include "pipeline_mem.h"
+#include "image_cache.h"
+#include "sdl.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    void *data;
+    size_t size;
+} Scratch;
+
+static Scratch scratch[PIPELINE_BUF_COUNT];
+static size_t scratch_bytes = 0;
+static size_t budget = PIPELINE_BUDGET_DEFAULT;
+static size_t peak = 0;
+static Uint32 last_use = 0;
+
+static void note_peak(size_t bytes) {
+    if (bytes > peak) peak = bytes;
+}
+
+int pipeline_admit(size_t bytes) {
+    if (scratch_bytes + bytes > budget) return 0;
+    size_t room = budget - scratch_bytes - bytes;
+    if (image_cache_bytes() > room) image_cache_trim(room);
+    if (image_cache_bytes() > room) return 0;   // pinned images in the way
+    note_peak(pipeline_current() + bytes);
+    return 1;
+}
+
+void *pipeline_buffer(int which, size_t size) {
+    Scratch *s = &scratch[which];
+    last_use = SDL_GetTicks();
+    if (s->size >= size) return s->data;
+
+    // Whole megabytes, so slightly larger jobs reuse the buffer; the old one goes first
+    size = (size + 0xFFFFF) & ~(size_t)0xFFFFF;
+    free(s->data);
+    scratch_bytes -= s->size;
+    s->data = NULL;
+    s->size = 0;
+
+    if (!pipeline_admit(size)) return NULL;
+    s->data = image_cache_alloc(size);
+    if (!s->data) return NULL;
+    s->size = size;
+    scratch_bytes += size;
+    return s->data;
+}
+
+void pipeline_release(void) {
+    for (int i = 0; i < PIPELINE_BUF_COUNT; i++) {
+        free(scratch[i].data);
+        scratch[i].data = NULL;
+        scratch[i].size = 0;
+    }
+    scratch_bytes = 0;
+}
+
+void pipeline_tick(void) {
+    if (scratch_bytes > 0 && SDL_GetTicks() - last_use > PIPELINE_IDLE_MS) pipeline_release();
+}
+
+void pipeline_set_budget(size_t bytes) {
+    budget = bytes < PIPELINE_BUDGET_MIN ? PIPELINE_BUDGET_MIN : bytes;
+    if (pipeline_current() > budget) {
+        pipeline_release();
+        image_cache_trim(budget);
+    }
+}
+
+size_t pipeline_budget(void) {
+    return budget;
+}
+
+size_t pipeline_current(void) {
+    return scratch_bytes + image_cache_bytes();
+}
+
+size_t pipeline_peak(void) {
+    return peak;
+}
+
+void pipeline_report(char *buf, size_t size) {
+    snprintf(buf, size, "Pipeline memory: %zu KB in use (%zu KB buffers, %zu KB cache), peak %zu KB, budget %zu MB",
+             pipeline_current() / 1024, scratch_bytes / 1024, image_cache_bytes() / 1024,
+             peak / 1024, budget / (1024 * 1024));
+}
@@ -0,0 +1,46 @@
+#ifndef PIPELINE_MEM_H
+#define PIPELINE_MEM_H
+
+#include <stddef.h>
+
+/*
+Image pipeline memory
+
+The to_ascii scratch buffers (base64 text, encoded bytes) are sized to the
+job at hand, reused by the next one and freed after PIPELINE_IDLE_MS without
+use. Decodes are admitted from the image header, before any pixel is
+allocated, against one budget shared with the image cache: least recently
+used images are evicted to make room, and what still does not fit is refused.
+*/
+
+#define PIPELINE_BUDGET_DEFAULT  (128 * 1024 * 1024)
+#define PIPELINE_BUDGET_MIN      (16 * 1024 * 1024)
+#define PIPELINE_IDLE_MS         10000
+
+enum {
+    PIPELINE_BUF_BASE64,        /* image as fetched, base64 text */
+    PIPELINE_BUF_RAW,           /* encoded image bytes */
+    PIPELINE_BUF_COUNT
+};
+
+/* Scratch buffer which of at least size bytes (contents not kept); NULL if over budget */
+void *pipeline_buffer(int which, size_t size);
+
+/* 1 if bytes more fit the budget, evicting cached images if needed */
+int pipeline_admit(size_t bytes);
+
+/* Free the scratch buffers now / once they have been idle long enough (every frame) */
+void pipeline_release(void);
+void pipeline_tick(void);
+
+void pipeline_set_budget(size_t bytes);
+size_t pipeline_budget(void);
+
+/* Scratch buffers plus cached images, now and at the highest admitted point */
+size_t pipeline_current(void);
+size_t pipeline_peak(void);
+
+/* One-line usage summary */
+void pipeline_report(char *buf, size_t size);
+
+#endif /* PIPELINE_MEM_H */
@@ -0,0 +1,583 @@
+#include "png_writer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+Deflate: greedy LZ77 over a sliding 32 KB window with hash chains,
+coded with the fixed Huffman tables (RFC 1951, 3.2.6). Rendered text
+images are mostly long runs, so matches dominate and the fixed code
+costs little compared to a dynamic one, while keeping the coder tiny.
+*/
+
+#define WSIZE        32768
+#define WMASK        (WSIZE - 1)
+#define WBUF         (2 * WSIZE)
+#define HASH_BITS    15
+#define HASH_SIZE    (1 << HASH_BITS)
+#define MIN_MATCH    3
+#define MAX_MATCH    258
+#define LOOKAHEAD    (MAX_MATCH + MIN_MATCH + 1)
+#define MAX_STORED   65535
+#define IDAT_CHUNK   65536
+
+typedef struct {
+    int chain;      /* max hash chain candidates examined */
+    int nice;       /* stop searching once a match is this long */
+} DeflateLevel;
+
+static const DeflateLevel deflate_levels[10] = {
+    {0, 0}, {1, 16}, {4, 32}, {8, 64}, {16, 128},
+    {32, 128}, {64, 258}, {128, 258}, {512, 258}, {2048, 258}
+};
+
+static const uint16_t len_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t len_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static uint32_t crc_table[256];
+static uint16_t lit_code[288];
+static uint8_t  lit_bits[288];
+static uint8_t  dist_code[30];
+static uint8_t  len_index[MAX_MATCH + 1];   /* match length -> len_base index */
+static uint8_t  dist_index[512];            /* (dist - 1) -> dist_base index */
+static int tables_state = 0;     /* 0 = empty, 1 = building, 2 = ready; writers may start on any thread */
+
+struct PngWriter {
+    png_sink_func sink;
+    void *ctx;
+    int failed;
+    size_t total;
+
+    int width;
+    int height;
+    int bit_depth;
+    int indexed;
+    int bpp;                /* bytes per pixel, for the Sub/Paeth filters */
+    size_t stride;
+    int rows_written;
+    uint8_t *packed;        /* sub-byte indexed rows, packed MSB first */
+    uint8_t *prev_row;
+    uint8_t *candidates;    /* 4 filtered versions of the current row */
+
+    /* IDAT chunk being filled: 8 byte header, data, 4 byte CRC */
+    uint8_t chunk[8 + IDAT_CHUNK + 4];
+    size_t chunk_len;
+
+    int level;
+    int chain;
+    int nice;
+    uint32_t bitbuf;
+    int bitcnt;
+    uint32_t adler_a;
+    uint32_t adler_b;
+
+    uint8_t window[WBUF];
+    size_t win_len;
+    size_t win_pos;
+    uint32_t win_base;      /* stream position of window[0] */
+    uint32_t head[HASH_SIZE];   /* stream position + 1, 0 = empty */
+    uint32_t prev[WSIZE];
+};
+
+static uint16_t reverse_bits(uint16_t code, int len) {
+    uint16_t r = 0;
+    for (int i = 0; i < len; i++) {
+        r = (uint16_t)((r << 1) | (code & 1));
+        code >>= 1;
+    }
+    return r;
+}
+
+static void init_tables(void) {
+    int expected = 0;
+    if (__atomic_load_n(&tables_state, __ATOMIC_ACQUIRE) == 2) return;
+    if (!__atomic_compare_exchange_n(&tables_state, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&tables_state, __ATOMIC_ACQUIRE) != 2) { }
+        return;
+    }
+
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[n] = c;
+    }
+
+    for (int n = 0; n < 288; n++) {
+        uint16_t code;
+        int len;
+        if (n < 144)      { code = (uint16_t)(0x30 + n);         len = 8; }
+        else if (n < 256) { code = (uint16_t)(0x190 + n - 144); len = 9; }
+        else if (n < 280) { code = (uint16_t)(n - 256);          len = 7; }
+        else              { code = (uint16_t)(0xC0 + n - 280);   len = 8; }
+        lit_code[n] = reverse_bits(code, len);
+        lit_bits[n] = (uint8_t)len;
+    }
+
+    for (int d = 0; d < 30; d++) dist_code[d] = (uint8_t)reverse_bits((uint16_t)d, 5);
+
+    for (int i = 0; i < 29; i++) {
+        for (int l = len_base[i]; l < len_base[i] + (1 << len_extra[i]) && l <= MAX_MATCH; l++) {
+            len_index[l] = (uint8_t)i;
+        }
+    }
+
+    for (int i = 0; i < 30; i++) {
+        for (int v = dist_base[i] - 1; v < dist_base[i] - 1 + (1 << dist_extra[i]); v++) {
+            if (v < 256) dist_index[v] = (uint8_t)i;
+            else dist_index[256 + (v >> 7)] = (uint8_t)i;
+        }
+    }
+
+    __atomic_store_n(&tables_state, 2, __ATOMIC_RELEASE);
+}
+
+static uint32_t crc_update(uint32_t crc, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/* ─── Output ─────────────────────────────────────────────────────── */
+
+static void emit(PngWriter *pw, const void *data, size_t len) {
+    if (pw->failed || len == 0) return;
+    if (!pw->sink(pw->ctx, data, len)) {
+        pw->failed = 1;
+        return;
+    }
+    pw->total += len;
+}
+
+static void write_chunk(PngWriter *pw, const char *type, const uint8_t *data, size_t len) {
+    uint8_t hdr[8], crc_buf[4];
+    put_be32(hdr, (uint32_t)len);
+    memcpy(hdr + 4, type, 4);
+
+    uint32_t crc = crc_update(0xFFFFFFFFu, hdr + 4, 4);
+    crc = crc_update(crc, data, len) ^ 0xFFFFFFFFu;
+    put_be32(crc_buf, crc);
+
+    emit(pw, hdr, 8);
+    emit(pw, data, len);
+    emit(pw, crc_buf, 4);
+}
+
+static void flush_idat(PngWriter *pw) {
+    if (pw->chunk_len == 0) return;
+
+    put_be32(pw->chunk, (uint32_t)pw->chunk_len);
+    memcpy(pw->chunk + 4, "IDAT", 4);
+    uint32_t crc = crc_update(0xFFFFFFFFu, pw->chunk + 4, 4 + pw->chunk_len) ^ 0xFFFFFFFFu;
+    put_be32(pw->chunk + 8 + pw->chunk_len, crc);
+
+    emit(pw, pw->chunk, 12 + pw->chunk_len);
+    pw->chunk_len = 0;
+}
+
+static inline void out_byte(PngWriter *pw, uint8_t b) {
+    pw->chunk[8 + pw->chunk_len++] = b;
+    if (pw->chunk_len == IDAT_CHUNK) flush_idat(pw);
+}
+
+static inline void put_bits(PngWriter *pw, uint32_t value, int n) {
+    pw->bitbuf |= value << pw->bitcnt;
+    pw->bitcnt += n;
+    while (pw->bitcnt >= 8) {
+        out_byte(pw, (uint8_t)pw->bitbuf);
+        pw->bitbuf >>= 8;
+        pw->bitcnt -= 8;
+    }
+}
+
+static void align_byte(PngWriter *pw) {
+    if (pw->bitcnt > 0) put_bits(pw, 0, 8 - pw->bitcnt);
+}
+
+/* ─── Deflate ────────────────────────────────────────────────────── */
+
+static inline uint32_t hash3(const uint8_t *p) {
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static inline void insert_hash(PngWriter *pw, size_t idx) {
+    uint32_t h = hash3(pw->window + idx);
+    uint32_t pos = pw->win_base + (uint32_t)idx;
+    pw->prev[pos & WMASK] = pw->head[h];
+    pw->head[h] = pos + 1;
+}
+
+static inline void emit_literal(PngWriter *pw, uint8_t c) {
+    put_bits(pw, lit_code[c], lit_bits[c]);
+}
+
+static inline void emit_match(PngWriter *pw, int len, uint32_t dist) {
+    int li = len_index[len];
+    put_bits(pw, lit_code[257 + li], lit_bits[257 + li]);
+    put_bits(pw, (uint32_t)(len - len_base[li]), len_extra[li]);
+
+    uint32_t v = dist - 1;
+    int di = v < 256 ? dist_index[v] : dist_index[256 + (v >> 7)];
+    put_bits(pw, dist_code[di], 5);
+    put_bits(pw, v - (dist_base[di] - 1u), dist_extra[di]);
+}
+
+static void emit_stored(PngWriter *pw, const uint8_t *data, size_t len, int final) {
+    put_bits(pw, final ? 1 : 0, 1);
+    put_bits(pw, 0, 2);
+    align_byte(pw);
+    out_byte(pw, (uint8_t)len);
+    out_byte(pw, (uint8_t)(len >> 8));
+    out_byte(pw, (uint8_t)~len);
+    out_byte(pw, (uint8_t)(~len >> 8));
+    for (size_t i = 0; i < len; i++) out_byte(pw, data[i]);
+}
+
+/* Encode window bytes from win_pos; keeps LOOKAHEAD bytes back unless final */
+static void deflate_window(PngWriter *pw, int final) {
+    const uint8_t *w = pw->window;
+    size_t limit = pw->win_len;
+    if (!final) limit = limit > LOOKAHEAD ? limit - LOOKAHEAD : 0;
+
+    size_t p = pw->win_pos;
+    while (p < limit) {
+        size_t avail = pw->win_len - p;
+        int best_len = 0;
+        uint32_t best_dist = 0;
+
+        if (avail >= MIN_MATCH) {
+            uint32_t pos = pw->win_base + (uint32_t)p;
+            uint32_t h = hash3(w + p);
+            uint32_t cand = pw->head[h];
+            pw->prev[pos & WMASK] = cand;
+            pw->head[h] = pos + 1;
+
+            int max_len = avail < MAX_MATCH ? (int)avail : MAX_MATCH;
+            int chain = pw->chain;
+            while (cand && chain-- > 0) {
+                uint32_t c = cand - 1;
+                uint32_t dist = pos - c;
+                if (dist == 0 || dist >= WSIZE) break;
+
+                const uint8_t *m = w + (c - pw->win_base);
+                if (m[best_len] == w[p + best_len] && m[0] == w[p]) {
+                    int l = 0;
+                    while (l < max_len && m[l] == w[p + l]) l++;
+                    if (l > best_len) {
+                        best_len = l;
+                        best_dist = dist;
+                        if (l >= pw->nice || l >= max_len) break;
+                    }
+                }
+
+                uint32_t next = pw->prev[c & WMASK];
+                if (next >= cand) break;
+                cand = next;
+            }
+        }
+
+        if (best_len >= MIN_MATCH) {
+            emit_match(pw, best_len, best_dist);
+            if (pw->level >= 4 || best_len <= pw->nice) {
+                for (int i = 1; i < best_len; i++) {
+                    if (p + i + MIN_MATCH <= pw->win_len) insert_hash(pw, p + i);
+                }
+            }
+            p += best_len;
+        } else {
+            emit_literal(pw, w[p]);
+            p++;
+        }
+    }
+    pw->win_pos = p;
+}
+
+static void deflate_feed(PngWriter *pw, const uint8_t *data, size_t len) {
+    // Adler-32 of the uncompressed stream, modulo deferred per 5552 bytes
+    const uint8_t *a = data;
+    size_t left = len;
+    while (left > 0) {
+        size_t n = left < 5552 ? left : 5552;
+        for (size_t i = 0; i < n; i++) {
+            pw->adler_a += a[i];
+            pw->adler_b += pw->adler_a;
+        }
+        pw->adler_a %= 65521;
+        pw->adler_b %= 65521;
+        a += n;
+        left -= n;
+    }
+
+    while (len > 0) {
+        size_t cap = pw->level == 0 ? MAX_STORED : WBUF;
+        size_t room = cap - pw->win_len;
+        size_t n = len < room ? len : room;
+        memcpy(pw->window + pw->win_len, data, n);
+        pw->win_len += n;
+        data += n;
+        len -= n;
+
+        if (pw->win_len < cap) break;
+
+        if (pw->level == 0) {
+            emit_stored(pw, pw->window, pw->win_len, 0);
+            pw->win_len = 0;
+            continue;
+        }
+
+        deflate_window(pw, 0);
+
+        // Slide: keep WSIZE bytes of history behind the encode position
+        if (pw->win_pos > WSIZE) {
+            size_t shift = pw->win_pos - WSIZE;
+            memmove(pw->window, pw->window + shift, pw->win_len - shift);
+            pw->win_len -= shift;
+            pw->win_pos -= shift;
+            pw->win_base += (uint32_t)shift;
+        }
+    }
+}
+
+static void deflate_finish(PngWriter *pw) {
+    if (pw->level == 0) {
+        if (pw->win_len > 0) emit_stored(pw, pw->window, pw->win_len, 0);
+        emit_stored(pw, NULL, 0, 1);
+    } else {
+        deflate_window(pw, 1);
+        put_bits(pw, lit_code[256], lit_bits[256]);
+        // Empty final fixed block closes the stream
+        put_bits(pw, 1, 1);
+        put_bits(pw, 1, 2);
+        put_bits(pw, lit_code[256], lit_bits[256]);
+    }
+    align_byte(pw);
+
+    uint32_t adler = (pw->adler_b << 16) | pw->adler_a;
+    out_byte(pw, (uint8_t)(adler >> 24));
+    out_byte(pw, (uint8_t)(adler >> 16));
+    out_byte(pw, (uint8_t)(adler >> 8));
+    out_byte(pw, (uint8_t)adler);
+}
+
+/* ─── Filters ────────────────────────────────────────────────────── */
+
+static inline uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    if (pb <= pc) return (uint8_t)b;
+    return (uint8_t)c;
+}
+
+/*
+ Flat-color text rows are mostly runs broken by antialiased edges, so the
+ filter leaving the fewest nonzero residuals wins (rather than the usual
+ minimum sum of absolute values, which favors noisy photo content).
+*/
+static int choose_filter(PngWriter *pw, const uint8_t *row, const uint8_t **out) {
+    const uint8_t *up = pw->prev_row;
+    size_t n = pw->stride;
+    int bpp = pw->bpp;
+
+    if (pw->rows_written > 0 && memcmp(row, up, n) == 0) {
+        memset(pw->candidates, 0, n);
+        *out = pw->candidates;
+        return 2;
+    }
+
+    uint8_t *sub = pw->candidates;
+    uint8_t *upf = pw->candidates + n;
+    uint8_t *pae = pw->candidates + 2 * n;
+    size_t score[4] = {0, 0, 0, 0};
+
+    for (size_t i = 0; i < n; i++) {
+        int a = i >= (size_t)bpp ? row[i - bpp] : 0;
+        int c = i >= (size_t)bpp ? up[i - bpp] : 0;
+        sub[i] = (uint8_t)(row[i] - a);
+        upf[i] = (uint8_t)(row[i] - up[i]);
+        pae[i] = (uint8_t)(row[i] - paeth(a, up[i], c));
+        score[0] += row[i] != 0;
+        score[1] += sub[i] != 0;
+        score[2] += upf[i] != 0;
+        score[3] += pae[i] != 0;
+    }
+
+    int best = 0;
+    for (int f = 1; f < 4; f++) {
+        if (score[f] < score[best]) best = f;
+    }
+
+    static const int png_filter_type[4] = {0, 1, 2, 4};
+    *out = best == 0 ? row : pw->candidates + (size_t)(best - 1) * n;
+    return png_filter_type[best];
+}
+
+/* ─── Public API ─────────────────────────────────────────────────── */
+
+static PngWriter *writer_begin(int width, int height, int color_type, int bit_depth, int bpp,
+                               const uint8_t *palette, int palette_size, int level,
+                               png_sink_func sink, void *ctx) {
+    if (width <= 0 || height <= 0 || !sink) return NULL;
+    if (level < 0) level = 0;
+    if (level > 9) level = 9;
+
+    init_tables();
+
+    PngWriter *pw = (PngWriter *)calloc(1, sizeof(PngWriter));
+    if (!pw) return NULL;
+
+    pw->sink = sink;
+    pw->ctx = ctx;
+    pw->width = width;
+    pw->height = height;
+    pw->bit_depth = bit_depth;
+    pw->indexed = color_type == 3;
+    pw->bpp = bpp;
+    pw->stride = ((size_t)width * bpp * bit_depth + 7) / 8;
+    pw->level = level;
+    pw->chain = deflate_levels[level].chain;
+    pw->nice = deflate_levels[level].nice;
+    pw->adler_a = 1;
+
+    pw->prev_row = (uint8_t *)calloc(pw->stride, 1);
+    pw->candidates = (uint8_t *)malloc(pw->stride * 3);
+    if (bit_depth < 8) pw->packed = (uint8_t *)malloc(pw->stride);
+    if (!pw->prev_row || !pw->candidates || (bit_depth < 8 && !pw->packed)) {
+        free(pw->prev_row);
+        free(pw->candidates);
+        free(pw->packed);
+        free(pw);
+        return NULL;
+    }
+
+    static const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    emit(pw, signature, 8);
+
+    uint8_t ihdr[13];
+    put_be32(ihdr, (uint32_t)width);
+    put_be32(ihdr + 4, (uint32_t)height);
+    ihdr[8] = (uint8_t)bit_depth;
+    ihdr[9] = (uint8_t)color_type;
+    ihdr[10] = 0;   // deflate
+    ihdr[11] = 0;   // adaptive filtering
+    ihdr[12] = 0;   // no interlace
+    write_chunk(pw, "IHDR", ihdr, sizeof(ihdr));
+
+    if (palette) write_chunk(pw, "PLTE", palette, (size_t)palette_size * 3);
+
+    // zlib header (FLEVEL hint only), then one open fixed-Huffman block
+    out_byte(pw, 0x78);
+    out_byte(pw, level <= 1 ? 0x01 : level <= 5 ? 0x5E : level <= 7 ? 0x9C : 0xDA);
+    if (level > 0) {
+        put_bits(pw, 0, 1);
+        put_bits(pw, 1, 2);
+    }
+
+    return pw;
+}
+
+PngWriter *png_writer_begin(int width, int height, int channels, int level,
+                            png_sink_func sink, void *ctx) {
+    if (channels != 1 && channels != 3 && channels != 4) return NULL;
+    int color_type = channels == 1 ? 0 : channels == 3 ? 2 : 6;
+    return writer_begin(width, height, color_type, 8, channels, NULL, 0, level, sink, ctx);
+}
+
+PngWriter *png_writer_begin_indexed(int width, int height, int bit_depth,
+                                    const uint8_t *palette, int palette_size, int level,
+                                    png_sink_func sink, void *ctx) {
+    if (bit_depth != 1 && bit_depth != 2 && bit_depth != 4 && bit_depth != 8) return NULL;
+    if (!palette || palette_size <= 0 || palette_size > (1 << bit_depth)) return NULL;
+    return writer_begin(width, height, 3, bit_depth, 1, palette, palette_size, level, sink, ctx);
+}
+
+int png_writer_row(PngWriter *pw, const uint8_t *row) {
+    if (!pw || pw->failed || pw->rows_written >= pw->height) return 0;
+
+    if (pw->packed) {
+        int bd = pw->bit_depth;
+        memset(pw->packed, 0, pw->stride);
+        for (int x = 0; x < pw->width; x++) {
+            int bit = x * bd;
+            pw->packed[bit >> 3] |= (uint8_t)((row[x] & ((1 << bd) - 1)) << (8 - bd - (bit & 7)));
+        }
+        row = pw->packed;
+    }
+
+    // Palette images compress best unfiltered (PNG spec, 12.8)
+    const uint8_t *filtered = row;
+    uint8_t filter = pw->indexed ? 0 : (uint8_t)choose_filter(pw, row, &filtered);
+
+    deflate_feed(pw, &filter, 1);
+    deflate_feed(pw, filtered, pw->stride);
+
+    memcpy(pw->prev_row, row, pw->stride);
+    pw->rows_written++;
+    return !pw->failed;
+}
+
+size_t png_writer_end(PngWriter *pw) {
+    if (!pw) return 0;
+
+    size_t total = 0;
+    if (!pw->failed && pw->rows_written == pw->height) {
+        deflate_finish(pw);
+        flush_idat(pw);
+        write_chunk(pw, "IEND", NULL, 0);
+        if (!pw->failed) total = pw->total;
+    }
+
+    free(pw->prev_row);
+    free(pw->candidates);
+    free(pw->packed);
+    free(pw);
+    return total;
+}
+
+/* ─── Sinks ──────────────────────────────────────────────────────── */
+
+int png_buffer_sink(void *ctx, const void *data, size_t len) {
+    PngBuffer *b = (PngBuffer *)ctx;
+    if (b->size + len > b->capacity) {
+        size_t cap = b->capacity ? b->capacity : IDAT_CHUNK;
+        while (cap < b->size + len) cap *= 2;
+        unsigned char *p = (unsigned char *)realloc(b->buf, cap);
+        if (!p) return 0;
+        b->buf = p;
+        b->capacity = cap;
+    }
+    memcpy(b->buf + b->size, data, len);
+    b->size += len;
+    return 1;
+}
+
+void png_buffer_free(PngBuffer *b) {
+    if (!b) return;
+    free(b->buf);
+    b->buf = NULL;
+    b->size = 0;
+    b->capacity = 0;
+}
+
+int png_file_sink(void *ctx, const void *data, size_t len) {
+    return fwrite(data, 1, len, (FILE *)ctx) == len;
+}
@@ -0,0 +1,59 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+Streaming PNG encoder
+
+Rows are filtered and deflated as they arrive; finished IDAT chunks are
+handed to a sink, so the whole encoded file never has to sit in one buffer.
+
+Levels: 0 = stored (no compression), 1 = fastest ... 9 = smallest
+*/
+
+#define PNG_LEVEL_STORE    0
+#define PNG_LEVEL_FAST     1
+#define PNG_LEVEL_DEFAULT  5
+#define PNG_LEVEL_BEST     9
+
+/* Receives encoded bytes in order; return 0 to abort the encode */
+typedef int (*png_sink_func)(void *ctx, const void *data, size_t len);
+
+/* Growable in-memory sink */
+typedef struct {
+    unsigned char *buf;
+    size_t size;
+    size_t capacity;
+} PngBuffer;
+
+int png_buffer_sink(void *ctx, const void *data, size_t len);
+void png_buffer_free(PngBuffer *b);
+
+/* FILE* sink (ctx is the FILE*) */
+int png_file_sink(void *ctx, const void *data, size_t len);
+
+typedef struct PngWriter PngWriter;
+
+/* 8-bit gray (1), RGB (3) or RGBA (4) image */
+PngWriter *png_writer_begin(int width, int height, int channels, int level,
+                            png_sink_func sink, void *ctx);
+
+/*
+ Indexed-color image with a palette of palette_size RGB triples.
+ bit_depth is 1, 2, 4 or 8; rows are still passed as one index byte per
+ pixel and packed by the writer.
+*/
+PngWriter *png_writer_begin_indexed(int width, int height, int bit_depth,
+                                    const uint8_t *palette, int palette_size, int level,
+                                    png_sink_func sink, void *ctx);
+
+/* Append one row (width * channels bytes, or width indices); returns 0 on failure */
+int png_writer_row(PngWriter *pw, const uint8_t *row);
+
+/* Flush, write IEND and free the writer; returns total bytes or 0 on failure */
+size_t png_writer_end(PngWriter *pw);
+
+#endif /* PNG_WRITER_H */
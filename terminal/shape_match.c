@@ -0,0 +1,211 @@
+#include "shape_match.h"
+#include "glyph_cache.h"
+#include "workers.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Source span [lo, hi) of each output sample for a box filter of src -> dst; never empty */
+static void box_bounds(int *lo, int *hi, int src, int dst) {
+    for (int i = 0; i < dst; i++) {
+        lo[i] = (int)((long long)i * src / dst);
+        hi[i] = (int)((long long)(i + 1) * src / dst);
+        if (hi[i] <= lo[i]) hi[i] = lo[i] + 1;
+    }
+}
+
+static void resample_coverage(const uint8_t *src, int sw, int sh, uint8_t *dst) {
+    int x0[SHAPE_W], x1[SHAPE_W], y0[SHAPE_H], y1[SHAPE_H];
+    box_bounds(x0, x1, sw, SHAPE_W);
+    box_bounds(y0, y1, sh, SHAPE_H);
+
+    for (int oy = 0; oy < SHAPE_H; oy++) {
+        for (int ox = 0; ox < SHAPE_W; ox++) {
+            unsigned sum = 0, n = 0;
+            for (int y = y0[oy]; y < y1[oy]; y++) {
+                for (int x = x0[ox]; x < x1[ox]; x++, n++) sum += src[y * sw + x];
+            }
+            dst[oy * SHAPE_W + ox] = (uint8_t)(n ? (sum + n / 2) / n : 0);
+        }
+    }
+}
+
+int shape_set_build(ShapeSet *set, TTF_Font *font, const char *const *glyphs, int count) {
+    if (!set || !font || !glyphs) return 0;
+    memset(set, 0, sizeof(*set));
+
+    // Repeated glyphs would only tie, so each gets one template
+    const char *strs[256];
+    int unique = 0;
+    for (int i = 0; i < count && i < 256; i++) {
+        int seen = 0;
+        for (int t = 0; t < unique && !seen; t++) seen = strcmp(strs[t], glyphs[i]) == 0;
+        if (seen) continue;
+        strs[unique] = glyphs[i];
+        set->glyphs[unique++] = (uint8_t)i;
+    }
+    count = unique;
+    if (count == 0) return 0;
+
+    GlyphSet raster;
+    if (!glyph_set_build(&raster, font, strs, count)) return 0;
+
+    set->templates = (uint8_t *)malloc((size_t)count * SHAPE_PX);
+    if (!set->templates) {
+        glyph_set_free(&raster);
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        resample_coverage(glyph_set_bitmap(&raster, i), raster.cell_w, raster.cell_h,
+                          set->templates + (size_t)i * SHAPE_PX);
+    }
+    glyph_set_free(&raster);
+
+    set->count = count;
+    return 1;
+}
+
+void shape_set_free(ShapeSet *set) {
+    if (!set) return;
+    free(set->templates);
+    memset(set, 0, sizeof(*set));
+}
+
+/* Sum of absolute differences over one SHAPE_PX block */
+static inline unsigned block_sad(const uint8_t *a, const uint8_t *b) {
+#if defined(__wasm_simd128__)
+    // 8 vectors of |a-b| summed pairwise into u16 lanes: at most 8 * 510, no overflow
+    v128_t acc = wasm_i16x8_splat(0);
+    for (int i = 0; i < SHAPE_PX; i += 16) {
+        v128_t va = wasm_v128_load(a + i);
+        v128_t vb = wasm_v128_load(b + i);
+        v128_t d = wasm_v128_or(wasm_u8x16_sub_sat(va, vb), wasm_u8x16_sub_sat(vb, va));
+        acc = wasm_i16x8_add(acc, wasm_u16x8_extadd_pairwise_u8x16(d));
+    }
+    v128_t s = wasm_u32x4_extadd_pairwise_u16x8(acc);
+    return wasm_u32x4_extract_lane(s, 0) + wasm_u32x4_extract_lane(s, 1) +
+           wasm_u32x4_extract_lane(s, 2) + wasm_u32x4_extract_lane(s, 3);
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (int i = 0; i < SHAPE_PX; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+    }
+    return (unsigned)_mm_cvtsi128_si32(acc) + (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#else
+    unsigned sum = 0;
+    for (int i = 0; i < SHAPE_PX; i++) sum += a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    return sum;
+#endif
+}
+
+typedef struct {
+    const ShapeSet *set;
+    const unsigned char *rgba;
+    int width;
+    int cols;
+    const int *x0, *x1;     /* source column span per template column */
+    const int *y0, *y1;     /* source row span per template row */
+    const uint8_t *tone;
+    uint8_t *cells;
+    int first;              /* grid row of band row 0 */
+    SDL_atomic_t failed;
+} MatchJob;
+
+static void match_rows(void *ctx, int begin, int end) {
+    MatchJob *job = (MatchJob *)ctx;
+    int plane_w = job->cols * SHAPE_W;
+
+    // One cell row of luma at template resolution, then gathered per cell
+    uint8_t *strip = (uint8_t *)malloc((size_t)plane_w * SHAPE_H);
+    if (!strip) {
+        SDL_AtomicSet(&job->failed, 1);
+        return;
+    }
+    uint8_t block[SHAPE_PX];
+
+    for (int row = job->first + begin; row < job->first + end; row++) {
+        for (int sy = 0; sy < SHAPE_H; sy++) {
+            int y0 = job->y0[row * SHAPE_H + sy], y1 = job->y1[row * SHAPE_H + sy];
+            uint8_t *dst = strip + (size_t)sy * plane_w;
+
+            for (int ox = 0; ox < plane_w; ox++) {
+                int x0 = job->x0[ox], x1 = job->x1[ox];
+                unsigned sum = 0;
+                for (int y = y0; y < y1; y++) {
+                    const unsigned char *px = job->rgba + ((size_t)y * job->width + x0) * 4;
+                    for (int x = x0; x < x1; x++, px += 4) {
+                        sum += (77 * px[0] + 150 * px[1] + 29 * px[2]) >> 8;
+                    }
+                }
+                unsigned n = (unsigned)((x1 - x0) * (y1 - y0));
+                uint8_t avg = (uint8_t)((sum + n / 2) / n);
+                dst[ox] = job->tone ? job->tone[avg] : avg;
+            }
+        }
+
+        uint8_t *line = job->cells + (size_t)row * job->cols;
+        for (int col = 0; col < job->cols; col++) {
+            for (int sy = 0; sy < SHAPE_H; sy++) {
+                memcpy(block + sy * SHAPE_W, strip + (size_t)sy * plane_w + col * SHAPE_W, SHAPE_W);
+            }
+
+            int best = 0;
+            unsigned best_sad = ~0u;
+            for (int g = 0; g < job->set->count; g++) {
+                unsigned sad = block_sad(block, job->set->templates + (size_t)g * SHAPE_PX);
+                if (sad < best_sad) {
+                    best_sad = sad;
+                    best = g;
+                }
+            }
+            line[col] = job->set->glyphs[best];
+        }
+    }
+    free(strip);
+}
+
+int shape_match_grid(const ShapeSet *set, const unsigned char *rgba, int width, int height,
+                     int cols, int rows, const uint8_t *tone, uint8_t *cells) {
+    return shape_match_rows(set, rgba, width, height, cols, rows, tone, cells, 0, rows);
+}
+
+int shape_match_rows(const ShapeSet *set, const unsigned char *rgba, int width, int height,
+                     int cols, int rows, const uint8_t *tone, uint8_t *cells, int begin, int end) {
+    if (!set || set->count == 0 || cols <= 0 || rows <= 0) return 0;
+    if (begin < 0) begin = 0;
+    if (end > rows) end = rows;
+    if (begin >= end) return 1;
+
+    int plane_w = cols * SHAPE_W, plane_h = rows * SHAPE_H;
+    int *bounds = (int *)malloc(2 * ((size_t)plane_w + plane_h) * sizeof(int));
+    if (!bounds) return 0;
+    int *x0 = bounds, *x1 = x0 + plane_w, *y0 = x1 + plane_w, *y1 = y0 + plane_h;
+    box_bounds(x0, x1, width, plane_w);
+    box_bounds(y0, y1, height, plane_h);
+
+    MatchJob job = {
+        .set = set,
+        .rgba = rgba,
+        .width = width,
+        .cols = cols,
+        .x0 = x0,
+        .x1 = x1,
+        .y0 = y0,
+        .y1 = y1,
+        .tone = tone,
+        .cells = cells,
+        .first = begin,
+    };
+    SDL_AtomicSet(&job.failed, 0);
+    run_bands(match_rows, &job, end - begin);
+
+    free(bounds);
+    return SDL_AtomicGet(&job.failed) == 0;
+}
@@ -0,0 +1,45 @@
+#ifndef SHAPE_MATCH_H
+#define SHAPE_MATCH_H
+
+#include <stdint.h>
+#include "sdl.h"
+
+/*
+Structure-matching glyph selection
+
+Every ramp glyph is rasterized once and box-filtered to a SHAPE_W x SHAPE_H
+luma template. Each image cell is downsampled to the same block and gets the
+glyph with the smallest sum of absolute differences, so edges and lines pick
+glyphs of matching shape instead of just matching brightness.
+*/
+
+#define SHAPE_W   8
+#define SHAPE_H   16
+#define SHAPE_PX  (SHAPE_W * SHAPE_H)
+
+/* Font size the templates are rasterized at before being resampled */
+#define SHAPE_FONT_SIZE 16
+
+typedef struct {
+    int count;
+    uint8_t *templates;    /* count * SHAPE_PX luma values */
+    uint8_t glyphs[256];   /* ramp glyph index of each template */
+} ShapeSet;
+
+/* One template per distinct UTF-8 glyph (at most 256); returns 1 on success */
+int shape_set_build(ShapeSet *set, TTF_Font *font, const char *const *glyphs, int count);
+void shape_set_free(ShapeSet *set);
+
+/*
+ Fill rows * cols cells with the glyph index of the best template. Cell luma
+ goes through tone (256 entries) unless it is NULL. Rows are matched in
+ parallel. Returns 0 on allocation failure.
+*/
+int shape_match_grid(const ShapeSet *set, const unsigned char *rgba, int width, int height,
+                     int cols, int rows, const uint8_t *tone, uint8_t *cells);
+
+/* Same for grid rows [begin, end) only */
+int shape_match_rows(const ShapeSet *set, const unsigned char *rgba, int width, int height,
+                     int cols, int rows, const uint8_t *tone, uint8_t *cells, int begin, int end);
+
+#endif /* SHAPE_MATCH_H */
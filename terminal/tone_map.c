@@ -0,0 +1,141 @@
+#include "tone_map.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Same integer luma as mode=shape */
+static inline unsigned luma(const unsigned char *px) {
+    return (77 * px[0] + 150 * px[1] + 29 * px[2]) >> 8;
+}
+
+/* Luma of 4 RGBA pixels into out[0..3] */
+static inline void luma4(const unsigned char *px, uint32_t out[4]) {
+#if defined(__wasm_simd128__)
+    const v128_t w = wasm_i16x8_make(77, 150, 29, 0, 77, 150, 29, 0);
+    v128_t v = wasm_v128_load(px);
+    v128_t lo = wasm_i32x4_dot_i16x8(wasm_u16x8_extend_low_u8x16(v), w);    // r*77+g*150, b*29 per pixel 0,1
+    v128_t hi = wasm_i32x4_dot_i16x8(wasm_u16x8_extend_high_u8x16(v), w);   // pixels 2,3
+    v128_t sum = wasm_i32x4_add(wasm_i32x4_shuffle(lo, hi, 0, 2, 4, 6), wasm_i32x4_shuffle(lo, hi, 1, 3, 5, 7));
+    wasm_v128_store(out, wasm_u32x4_shr(sum, 8));
+#elif defined(__SSE2__)
+    const __m128i w = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_loadu_si128((const __m128i *)px);
+    __m128 lo = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(v, zero), w));
+    __m128 hi = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(v, zero), w));
+    __m128i even = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i odd = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+    _mm_storeu_si128((__m128i *)out, _mm_srli_epi32(_mm_add_epi32(even, odd), 8));
+#else
+    for (int i = 0; i < 4; i++) out[i] = luma(px + i * 4);
+#endif
+}
+
+void tone_histogram(const unsigned char *rgba, int width, int height, int rows, uint32_t hist[256]) {
+    // Four partial histograms so neighbouring pixels of equal luma don't serialize on one counter
+    uint32_t part[4][256];
+    memset(part, 0, sizeof(part));
+    if (rows > height) rows = height;
+
+    for (int y = 0; y < rows; y++) {
+        const unsigned char *row = rgba + (size_t)((long long)y * height / rows) * width * 4;
+        int x = 0;
+        uint32_t l[4];
+        for (; x + 4 <= width; x += 4) {
+            luma4(row + (size_t)x * 4, l);
+            part[0][l[0]]++;
+            part[1][l[1]]++;
+            part[2][l[2]]++;
+            part[3][l[3]]++;
+        }
+        for (; x < width; x++) part[0][luma(row + (size_t)x * 4)]++;
+    }
+
+    for (int v = 0; v < 256; v++) hist[v] = part[0][v] + part[1][v] + part[2][v] + part[3][v];
+}
+
+/* Smallest luma with more than fraction of the samples at or below it */
+static int percentile(const uint32_t hist[256], uint64_t total, double fraction) {
+    uint64_t target = (uint64_t)(total * fraction), seen = 0;
+    for (int v = 0; v < 256; v++) {
+        seen += hist[v];
+        if (seen > target) return v;
+    }
+    return 255;
+}
+
+static void levels_curve(const uint32_t hist[256], uint64_t total, uint8_t curve[256]) {
+    int lo = percentile(hist, total, 0.005);
+    int hi = percentile(hist, total, 0.995);
+    if (hi <= lo) return;
+    for (int v = 0; v < 256; v++) {
+        int m = (v - lo) * 255 / (hi - lo);
+        curve[v] = (uint8_t)(m < 0 ? 0 : m > 255 ? 255 : m);
+    }
+}
+
+static void equalize_curve(const uint32_t hist[256], uint64_t total, uint8_t curve[256]) {
+    uint64_t first = 0, cdf = 0;
+    for (int v = 0; v < 256 && first == 0; v++) first = hist[v];
+    if (total <= first) return;
+    for (int v = 0; v < 256; v++) {
+        cdf += hist[v];
+        curve[v] = (uint8_t)(cdf <= first ? 0 : (cdf - first) * 255 / (total - first));
+    }
+}
+
+/* Gamma on top of curve that maps the image's median to mid-gray */
+static void median_gamma(const uint32_t hist[256], uint64_t total, uint8_t curve[256]) {
+    uint32_t mapped[256] = {0};
+    for (int v = 0; v < 256; v++) mapped[curve[v]] += hist[v];
+    int median = percentile(mapped, total, 0.5);
+    if (median <= 0 || median >= 255) return;
+
+    double gamma = log(0.5) / log(median / 255.0);
+    if (gamma < 0.4) gamma = 0.4;
+    if (gamma > 2.5) gamma = 2.5;
+    for (int v = 0; v < 256; v++) {
+        curve[v] = (uint8_t)(255.0 * pow(curve[v] / 255.0, gamma) + 0.5);
+    }
+}
+
+void tone_curve(const uint32_t hist[256], int tone, uint8_t curve[256]) {
+    for (int v = 0; v < 256; v++) curve[v] = (uint8_t)v;
+
+    uint64_t total = 0;
+    for (int v = 0; v < 256; v++) total += hist[v];
+    if (total == 0) return;
+
+    switch (tone) {
+        case TONE_LEVELS:
+            levels_curve(hist, total, curve);
+            break;
+        case TONE_EQUALIZE:
+            equalize_curve(hist, total, curve);
+            break;
+        case TONE_AUTO:
+            levels_curve(hist, total, curve);
+            median_gamma(hist, total, curve);
+            break;
+        default:
+            break;
+    }
+}
+
+static const char *tone_names[] = { "off", "levels", "equalize", "auto" };
+
+int tone_from_name(const char *name) {
+    for (int t = 0; t < (int)(sizeof(tone_names) / sizeof(tone_names[0])); t++) {
+        if (strcmp(name, tone_names[t]) == 0) return t;
+    }
+    return TONE_OFF;
+}
+
+const char *tone_name(int tone) {
+    return (tone >= 0 && tone < (int)(sizeof(tone_names) / sizeof(tone_names[0]))) ? tone_names[tone] : "off";
+}
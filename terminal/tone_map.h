@@ -0,0 +1,29 @@
+#ifndef TONE_MAP_H
+#define TONE_MAP_H
+
+#include <stdint.h>
+
+/*
+Image-adaptive tone curves
+
+A luma histogram is taken over the rows the character grid samples, and
+turned into a 256-entry curve (luma -> remapped luma). The curve is folded
+into the ramp LUT by the engine, so it costs nothing per cell.
+*/
+
+#define TONE_OFF       0
+#define TONE_LEVELS    1    /* stretch the 0.5% .. 99.5% percentiles to 0 .. 255 */
+#define TONE_EQUALIZE  2    /* histogram equalization */
+#define TONE_AUTO      3    /* levels, then a gamma that puts the median at mid-gray */
+
+/* Luma histogram of the rows pixel row y * height / rows samples, y < rows */
+void tone_histogram(const unsigned char *rgba, int width, int height, int rows, uint32_t hist[256]);
+
+/* Curve for tone from hist; identity for TONE_OFF or a flat histogram */
+void tone_curve(const uint32_t hist[256], int tone, uint8_t curve[256]);
+
+/* TONE_* for off/levels/equalize/auto, TONE_OFF if unknown */
+int tone_from_name(const char *name);
+const char *tone_name(int tone);
+
+#endif /* TONE_MAP_H */
@@ -0,0 +1,59 @@
+#include "workers.h"
+#include <SDL.h>
+
+typedef struct {
+    band_func fn;
+    void *ctx;
+    int begin;
+    int end;
+} BandJob;
+
+/* >0 while this thread runs a band; nested run_bands calls then stay inline */
+static _Thread_local int band_depth = 0;
+
+static int band_thread(void *data) {
+    BandJob *job = (BandJob *)data;
+    band_depth++;
+    job->fn(job->ctx, job->begin, job->end);
+    band_depth--;
+    return 0;
+}
+
+int worker_count(void) {
+    int n = SDL_GetCPUCount();
+    if (n < 1) n = 1;
+    if (n > WORKERS_MAX) n = WORKERS_MAX;
+    return n;
+}
+
+void run_bands(band_func fn, void *ctx, int count) {
+    if (count <= 0) return;
+
+    int n = worker_count();
+    if (n > count) n = count;
+    if (n <= 1 || band_depth > 0) {
+        fn(ctx, 0, count);
+        return;
+    }
+
+    BandJob jobs[WORKERS_MAX];
+    SDL_Thread *threads[WORKERS_MAX] = {0};
+
+    for (int i = 0; i < n; i++) {
+        jobs[i].fn = fn;
+        jobs[i].ctx = ctx;
+        jobs[i].begin = (int)((long long)count * i / n);
+        jobs[i].end = (int)((long long)count * (i + 1) / n);
+    }
+
+    // Band 0 runs on the caller, the rest on their own thread when possible
+    for (int i = 1; i < n; i++) {
+        threads[i] = SDL_CreateThread(band_thread, "band", &jobs[i]);
+        if (!threads[i]) band_thread(&jobs[i]);
+    }
+    band_thread(&jobs[0]);
+
+    for (int i = 1; i < n; i++) {
+        if (threads[i]) SDL_WaitThread(threads[i], NULL);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+/* Work callback: process items [begin, end) */
+typedef void (*band_func)(void *ctx, int begin, int end);
+
+#define WORKERS_MAX 64
+
+int worker_count(void);
+
+/*
+ Split [0, count) into contiguous bands and run them in parallel.
+ Falls back to the calling thread when threads are unavailable
+ (e.g. WASM build without -pthread). Calls made from inside a band run
+ inline, so nested parallel stages never oversubscribe the cores.
+*/
+void run_bands(band_func fn, void *ctx, int count);
+
+#endif /* WORKERS_H */